@@ -2,46 +2,350 @@
 #define AVL_TREE_H
 
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <future>
+#include <iterator>
+#include <atomic>
+#include <limits>
+#include <type_traits>
+#include <stdint.h>
+#include "FrozenTree.h"
+#include "NodePool.h"
 using namespace std;
 
+//------------------------------------------------------------------
+// Augmentation policies
+// Each node can carry a Summary of secondValue over its subtree, a
+//  monoid kept up to date through Insert, Delete and every rotation,
+//  so range_aggregate() answers in O(log n). A policy supplies the
+//  Summary type, its identity, lift() for one value and an associative
+//  combine(). NoAugment (the default) stores nothing. Values must not
+//  be changed in place through a returned Node* on an augmented tree,
+//  since the summaries above it would go stale; update() changes a
+//  value and refreshes them.
+//------------------------------------------------------------------
+struct NoAugment
+{
+   struct Summary {};
+   static Summary identity() { return Summary(); }
+   template <class Value>
+   static Summary lift(const Value &) { return Summary(); }
+   static Summary combine(const Summary &, const Summary &) { return Summary(); }
+};
+
+struct SumAugment
+{
+   typedef long long Summary;
+   static Summary identity() { return 0; }
+   template <class Value>
+   static Summary lift(const Value &v) { return v; }
+   static Summary combine(const Summary &a, const Summary &b) { return a + b; }
+};
+
+struct CountAugment
+{
+   typedef uint32_t Summary;
+   static Summary identity() { return 0; }
+   template <class Value>
+   static Summary lift(const Value &) { return 1; }
+   static Summary combine(const Summary &a, const Summary &b) { return a + b; }
+};
+
+struct MaxAugment
+{
+   typedef long long Summary;
+   static Summary identity() { return numeric_limits<long long>::min(); }
+   template <class Value>
+   static Summary lift(const Value &v) { return v; }
+   static Summary combine(const Summary &a, const Summary &b) { return max(a, b); }
+};
+
+//------------------------------------------------------------------
+// AVLTreeNode
+// Links are 32-bit indices into the owning tree's NodePool, and the
+//  balance factor lives in the top two bits of the subtree size, so a
+//  node with int key and value is 24 bytes (2.67 per 64-byte cache
+//  line) instead of the 48 bytes (1.33 per line) of the pointer layout.
+//------------------------------------------------------------------
+template <class Key, class Value, class Summary = NoAugment::Summary>
 struct AVLTreeNode
 {
-   int key;
-   int secondValue;
-   AVLTreeNode *left;
-   AVLTreeNode *right;
-   AVLTreeNode *parent;
-   AVL_Tree *nextTree;
-   char balanceFactor;
+   Key key;
+   Value secondValue;
+   NodeIndex left;
+   NodeIndex right;
+   NodeIndex parent;
+   uint32_t sizeAndBalance;   // subtree size | balance factor << 30
+   [[no_unique_address]] Summary summary;   // of secondValue over the subtree
+
+   static const uint32_t SIZE_MASK = (1u << 30) - 1;
+
+   uint32_t size() const { return sizeAndBalance & SIZE_MASK; }
+   void setSize(uint32_t s) { sizeAndBalance = (sizeAndBalance & ~SIZE_MASK) | s; }
+
+   // Balance factor as the familiar 'L', 'R' or '='
+   char balanceFactor() const
+   {
+      uint32_t b = sizeAndBalance >> 30;
+      return (b == 1) ? 'L' : (b == 2) ? 'R' : '=';
+   }
+   void setBalanceFactor(char bf)
+   {
+      uint32_t b = (bf == 'L') ? 1 : (bf == 'R') ? 2 : 0;
+      sizeAndBalance = (sizeAndBalance & SIZE_MASK) | (b << 30);
+   }
+};
+
+//------------------------------------------------------------------
+// Statistics policies
+// AVL_Tree reports search comparisons, rotations and delete retrace
+//  steps to its Stats parameter. NoStats (the default) does nothing
+//  and takes no space; CountingStats counts. collect_stats() adds a
+//  tree's counters, node count and height into a TreeStats.
+//------------------------------------------------------------------
+struct TreeStats
+{
+   uint64_t searches = 0;           // findIndex calls (search, Delete, ...)
+   uint64_t comparisons = 0;        // key comparisons made by those searches
+   uint64_t singleRotations = 0;    // on insert or join (restoreAVL, retraceInsert)
+   uint64_t doubleRotations = 0;    // likewise
+   uint64_t deleteRetraces = 0;     // levels walked by retraceDelete
+   uint64_t deleteRotations = 0;    // single or double, during retraceDelete
+   uint64_t nodes = 0;
+   int height = 0;                  // tallest tree collected
+
+   TreeStats& operator+=(const TreeStats &other);
 };
 
+struct NoStats
+{
+   void search() const {}
+   void comparison() const {}
+   void singleRotation() {}
+   void doubleRotation() {}
+   void deleteRetrace() {}
+   void deleteRotation() {}
+   void addTo(TreeStats &) const {}
+};
+
+// Counters are bumped from const lookups, which may run on several
+//  reader threads at once; relaxed load+store keeps that free of data
+//  races without a locked add, at the cost of an occasional lost count.
+class CountingStats
+{
+   private:
+      mutable atomic<uint64_t> searches{0}, comparisons{0};
+      atomic<uint64_t> singleRotations{0}, doubleRotations{0};
+      atomic<uint64_t> deleteRetraces{0}, deleteRotations{0};
+      static void bump(atomic<uint64_t> &counter)
+      {
+         counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+      }
+   public:
+      void search() const { bump(searches); }
+      void comparison() const { bump(comparisons); }
+      void singleRotation() { bump(singleRotations); }
+      void doubleRotation() { bump(doubleRotations); }
+      void deleteRetrace() { bump(deleteRetraces); }
+      void deleteRotation() { bump(deleteRotations); }
+      void addTo(TreeStats &out) const
+      {
+         out.searches += searches.load(memory_order_relaxed);
+         out.comparisons += comparisons.load(memory_order_relaxed);
+         out.singleRotations += singleRotations.load(memory_order_relaxed);
+         out.doubleRotations += doubleRotations.load(memory_order_relaxed);
+         out.deleteRetraces += deleteRetraces.load(memory_order_relaxed);
+         out.deleteRotations += deleteRotations.load(memory_order_relaxed);
+      }
+};
+
+inline TreeStats& TreeStats::operator+=(const TreeStats &other)
+{
+   searches += other.searches;
+   comparisons += other.comparisons;
+   singleRotations += other.singleRotations;
+   doubleRotations += other.doubleRotations;
+   deleteRetraces += other.deleteRetraces;
+   deleteRotations += other.deleteRotations;
+   nodes += other.nodes;
+   height = max(height, other.height);
+   return *this;
+}
+
+template <class Key, class Value, class Compare = less<Key>, class Stats = NoStats,
+          class Augment = NoAugment>
 class AVL_Tree
 {
+   public:
+      typedef AVLTreeNode<Key, Value, typename Augment::Summary> Node;
+      typedef typename Augment::Summary Summary;
+
+      //------------------------------------------------------------------
+      // iterator
+      // Bidirectional in-order iterator. Steps follow the parent links,
+      //  so a full walk costs O(n) and each step is amortized O(1).
+      //  end() is the position after the largest key; decrementing it
+      //  yields the largest key.
+      //------------------------------------------------------------------
+      class iterator
+      {
+         private:
+            const AVL_Tree *tree;
+            NodeIndex current;
+         public:
+            typedef bidirectional_iterator_tag iterator_category;
+            typedef Node value_type;
+            typedef ptrdiff_t difference_type;
+            typedef Node* pointer;
+            typedef Node& reference;
+
+            iterator() : tree(nullptr), current(NIL) {}
+            iterator(const AVL_Tree *t, NodeIndex i) : tree(t), current(i) {}
+            Node& operator*() const { return tree->N(current); }
+            Node* operator->() const { return &tree->N(current); }
+            iterator& operator++() { current = tree->nextIndex(current); return *this; }
+            iterator& operator--()
+            {
+               current = (current == NIL) ? tree->findMaxIndex(tree->root) : tree->prevIndex(current);
+               return *this;
+            }
+            iterator operator++(int) { iterator old = *this; ++*this; return old; }
+            iterator operator--(int) { iterator old = *this; --*this; return old; }
+            bool operator==(const iterator &other) const { return current == other.current; }
+            bool operator!=(const iterator &other) const { return current != other.current; }
+            NodeIndex index() const { return current; }
+      };
+      typedef std::reverse_iterator<iterator> reverse_iterator;
+
+      // [first, last) as something a range-based for loop can walk
+      struct Range
+      {
+         iterator first, last;
+         iterator begin() const { return first; }
+         iterator end() const { return last; }
+      };
+
    private:
-      AVLTreeNode* root;
-      void ClearTree(AVLTreeNode *n);
-      void Print(AVLTreeNode *n);
+      NodeIndex root;
+      NodeIndex maxFinger;      // Node holding the largest key, or NIL if unknown
+      NodePool<Node> ownPool;   // Storage for this tree's nodes unless shared
+      NodePool<Node> *pool;     // Pool the nodes actually live in
+      Compare comp;
+      [[no_unique_address]] Stats stats;
+      void Print(NodeIndex n);
+      uint32_t subtreeSize(NodeIndex n) const;
+      Summary summaryOf(NodeIndex n) const;
+      void updateSubtree(NodeIndex n);
+      NodeIndex findIndex(const Key &key) const;
+      NodeIndex findMaxIndex(NodeIndex n) const;
+      NodeIndex findMinIndex(NodeIndex n) const;
+      NodeIndex nextIndex(NodeIndex n) const;
+      NodeIndex prevIndex(NodeIndex n) const;
+      NodeIndex selectIndex(int rank) const;
+      Node& N(NodeIndex i) const { return pool->at(i); }
+      void releaseSubtree(NodeIndex n);
+      NodeIndex copySubtree(const AVL_Tree &other, NodeIndex src, NodeIndex parent);
+
+      // Split/join engine. These work on detached subtrees (parent NIL)
+      //  inside this tree's pool and pass subtree heights along.
+      bool retraceInsert(NodeIndex current, bool fromLeft);
+      void attach(NodeIndex newNode, NodeIndex parent, bool left);
+      int heightOf(NodeIndex n) const;
+      int leftHeight(NodeIndex n, int height) const;
+      int rightHeight(NodeIndex n, int height) const;
+      NodeIndex joinNodes(NodeIndex l, int hl, NodeIndex m, NodeIndex r, int hr, int &height);
+      NodeIndex splitNodes(NodeIndex t, int ht, const Key &key,
+                           NodeIndex &l, int &hl, NodeIndex &r, int &hr);
+      NodeIndex splitLast(NodeIndex t, int ht, NodeIndex &rest, int &hrest);
+      NodeIndex join2(NodeIndex l, int hl, NodeIndex r, int hr, int &height);
+      template <class Combine>
+      NodeIndex unionNodes(NodeIndex t1, int h1, NodeIndex t2, int h2, int &height,
+                           Combine &combine, vector<NodeIndex> &discards, int depth);
+      template <class Combine>
+      NodeIndex unionRange(const vector<NodeIndex> &roots, size_t lo, size_t hi, int &height,
+                           Combine &combine, vector<NodeIndex> &discards, int depth);
+      NodeIndex differenceNodes(NodeIndex t1, int h1, const AVL_Tree &other, NodeIndex t2,
+                                int &height, vector<NodeIndex> &discards);
+      NodeIndex buildBalanced(const vector<pair<Key, Value> > &items,
+                              size_t lo, size_t hi, NodeIndex parent, int &height);
    public:
       AVL_Tree();            // Constructor
+      explicit AVL_Tree(NodePool<Node> *sharedPool);   // Nodes live in sharedPool
       ~AVL_Tree();           // Destructor
-      void Insert(AVLTreeNode *n);
-      void restoreAVL(AVLTreeNode *ancestor, AVLTreeNode *newNode);
-      void adjustBalanceFactors(AVLTreeNode *end, AVLTreeNode *start);
-      void rotateLeft(AVLTreeNode *n);
-      void rotateRight(AVLTreeNode *n);
-      void adjustLeftRight(AVLTreeNode *end, AVLTreeNode *start);
-      void adjustRightLeft(AVLTreeNode *end, AVLTreeNode *start);
+      AVL_Tree(const AVL_Tree&) = delete;
+      AVL_Tree& operator=(const AVL_Tree&) = delete;
+      Node* Insert(const Key &key, const Value &value);
+      Node* insert_hint(iterator hint, const Key &key, const Value &value);
+      void restoreAVL(NodeIndex ancestor, NodeIndex newNode);
+      void adjustBalanceFactors(NodeIndex end, NodeIndex start);
+      void rotateLeft(NodeIndex n);
+      void rotateRight(NodeIndex n);
+      void adjustLeftRight(NodeIndex end, NodeIndex start);
+      void adjustRightLeft(NodeIndex end, NodeIndex start);
+      void retraceDelete(NodeIndex current, bool fromLeft);
       void PrintTree();
 
-      // NOT YET IMPLEMENTED
-      int Predecessor(int key);
-      int Successor(int key);
-      void Delete(int key);
-      AVLTreeNode* search(int key);
-      AVLTreeNode* getRoot() const;
-      AVLTreeNode* findMax(AVLTreeNode* node);
+      Node* Predecessor(const Key &key) const;
+      Node* Successor(const Key &key) const;
+      void Delete(const Key &key);
+      Node* search(const Key &key) const;
+      Node* getRoot() const;
+      Node* getNode(NodeIndex i) const;
+      Node* findMax() const;
+
+      // Bulk operations
+      void Clear();
+      template <class Reclaimer>
+      void Clear(Reclaimer &deferred);
+      void build_from_sorted(const vector<pair<Key, Value> > &items);
+      void collect_sorted(vector<pair<Key, Value> > &out) const;
+      FrozenTree<Key, Value, Compare> freeze() const;
 
+      void copy_from(const AVL_Tree &other);
+      NodePool<Node>* node_pool() const;
 
+      // Set operations. Keys must be unique. join and split only relink
+      //  nodes, so they run in O(log n) when the trees share a pool.
+      void join(AVL_Tree &left, const Key &key, const Value &value, AVL_Tree &right);
+      bool split(const Key &key, AVL_Tree &left, AVL_Tree &right);
+      void union_with(AVL_Tree &other, int threads = 1);
+      template <class Combine>
+      void union_with(AVL_Tree &other, Combine combine, int threads = 1);
+      template <class Combine>
+      void union_all(const vector<AVL_Tree*> &trees, Combine combine, int threads = 1);
+      void difference_with(const AVL_Tree &other);
+
+      // In-order iteration
+      iterator begin() const;
+      iterator end() const;
+      reverse_iterator rbegin() const;
+      reverse_iterator rend() const;
+      iterator find(const Key &key) const;
+      iterator lower_bound(const Key &key) const;
+      iterator upper_bound(const Key &key) const;
+      Range range(const Key &lo, const Key &hi) const;
+      iterator at_rank(int rank) const;
+
+      // Order statistics
+      int Size() const;
+      Node* select(int rank) const;
+      int rank_of(const Key &key) const;
+      int count_less(const Key &key) const;
+
+      // Augmented queries (see Augmentation policies above)
+      bool update(const Key &key, const Value &value);
+      Summary range_aggregate(const Key &lo, const Key &hi) const;
+      Summary aggregate() const;
+      Summary aggregate_less(const Key &key) const;
+      iterator at_weight(Summary weight) const;
+
+      // Instrumentation (see Stats policies above)
+      void collect_stats(TreeStats &out) const;
 };
 
+#include "AVL_Tree.tpp"
+
 #endif
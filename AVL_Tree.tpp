@@ -0,0 +1,1775 @@
+//------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVL_Tree<Key, Value, Compare, Stats, Augment>::AVL_Tree()
+{
+   root = NIL;   // Initialize root to NIL
+   maxFinger = NIL;   // No maximum known yet
+   pool = &ownPool;
+}
+
+//------------------------------------------------------------------
+// Shared-pool constructor
+// Nodes are carved from sharedPool, which must outlive the tree.
+//  Trees on one pool can join, split and union by relinking nodes.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVL_Tree<Key, Value, Compare, Stats, Augment>::AVL_Tree(NodePool<Node> *sharedPool)
+{
+   root = NIL;
+   maxFinger = NIL;
+   pool = sharedPool;
+}
+
+//------------------------------------------------------------------
+// Class destructor
+// The node pool releases all of its slabs at once, so there is no
+//  recursive walk over the tree. Nodes in a shared pool stay there
+//  until the pool itself is destroyed.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVL_Tree<Key, Value, Compare, Stats, Augment>::~AVL_Tree()
+{
+}
+
+//------------------------------------------------------------------
+// Insert()
+// Insert a new node holding key and value into the tree then restore
+//  the AVL property. Returns the new node.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::Insert(const Key &key, const Value &value)
+{
+   NodeIndex newNode, temp, back, ancestor;
+
+   // Carve the new node out of this tree's pool
+   newNode = pool->Allocate();
+   Node &n = N(newNode);
+   n.key = key;
+   n.secondValue = value;
+   n.left = NIL;
+   n.right = NIL;
+   n.parent = NIL;
+   n.sizeAndBalance = 0;
+   n.setSize(1);
+   n.setBalanceFactor('=');
+   n.summary = Augment::lift(value);
+
+   temp = root;
+   back = NIL;
+   ancestor = NIL;
+
+   // Check for empty tree first
+   if(root == NIL)
+   {
+      root = newNode;
+      maxFinger = newNode;
+      return &n;
+   }
+
+   // Appends (key >= the maximum) go straight under the max finger
+   if(maxFinger == NIL)
+      maxFinger = findMaxIndex(root);
+   if(!comp(key, N(maxFinger).key))
+   {
+      attach(newNode, maxFinger, false);
+      return &n;
+   }
+   // Tree is not empty so search for place to insert
+   while(temp != NIL) // Loop till temp falls out of the tree 
+   {
+      back = temp;
+      N(temp).setSize(N(temp).size() + 1);   // newNode will end up in this subtree
+      // Mark ancestor that will be out of balance after
+      //   this node is inserted
+      if(N(temp).balanceFactor() != '=')  
+         ancestor = temp;
+      if(comp(key, N(temp).key))
+         temp = N(temp).left;
+      else
+         temp = N(temp).right;
+   }
+   // temp is now NIL
+   // back points to parent node to attach newNode to
+   // ancestor points to most recent out of balance ancestor
+
+   n.parent = back;   // Set parent
+   if(comp(key, N(back).key))  // Insert at left
+   {
+      N(back).left = newNode;
+   }
+   else     // Insert at right
+   {
+      N(back).right = newNode;
+   }
+
+   // Summaries along the new path, bottom-up, before any rotation
+   //   reads them
+   if(!is_same<Augment, NoAugment>::value)
+      for(temp = back; temp != NIL; temp = N(temp).parent)
+         updateSubtree(temp);
+
+   // Now call function to restore the tree's AVL property
+   restoreAVL(ancestor, newNode);
+   return &n;
+}
+
+//------------------------------------------------------------------
+// attach()
+// Hang the fresh leaf newNode under parent on the given side (which
+//  must be empty), then fix sizes, summaries and balance on the way
+//  up. Appending under the max finger moves the finger to newNode.
+//  The size walk is O(log n); rebalancing is amortized O(1).
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::attach(NodeIndex newNode, NodeIndex parent, bool left)
+{
+   N(newNode).parent = parent;
+   if(left)
+      N(parent).left = newNode;
+   else
+      N(parent).right = newNode;
+   if(parent == maxFinger && !left)
+      maxFinger = newNode;
+
+   for(NodeIndex up = parent; up != NIL; up = N(up).parent)
+   {
+      if(is_same<Augment, NoAugment>::value)
+         N(up).setSize(N(up).size() + 1);
+      else
+         updateSubtree(up);
+   }
+   retraceInsert(parent, left);
+}
+
+//------------------------------------------------------------------
+// insert_hint()
+// Insert key just before hint, as std::map's hinted insert does. A
+//  right hint (the old key at hint is not less than key, and the one
+//  before it not greater) skips the descent from the root, so feeding
+//  ascending keys with end() as the hint appends in amortized O(1)
+//  rotations. A wrong hint falls back to Insert().
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::insert_hint(iterator hint, const Key &key, const Value &value)
+{
+   NodeIndex at = hint.index();
+   if(root == NIL || at == NIL)
+      return Insert(key, value);   // end(): Insert takes the append path
+   NodeIndex before = prevIndex(at);
+   if(comp(N(at).key, key) || (before != NIL && comp(key, N(before).key)))
+      return Insert(key, value);   // hint is not where key belongs
+
+   NodeIndex newNode = pool->Allocate();
+   Node &n = N(newNode);
+   n.key = key;
+   n.secondValue = value;
+   n.left = NIL;
+   n.right = NIL;
+   n.sizeAndBalance = 0;
+   n.setSize(1);
+   n.setBalanceFactor('=');
+   n.summary = Augment::lift(value);
+   // the slot just before at: its empty left link, or else the empty
+   //  right link of its in-order predecessor
+   if(N(at).left == NIL)
+      attach(newNode, at, true);
+   else
+      attach(newNode, before, false);
+   return &n;
+}
+
+//------------------------------------------------------------------
+// restoreAVL() 
+// Restore the AVL quality after inserting a new node.
+// @param ancestor – most recent node back up the tree that is
+//            now out of balance.
+// @param newNode– the newly inserted node.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::restoreAVL(NodeIndex ancestor, NodeIndex newNode)
+{
+   const Key &key = N(newNode).key;
+
+   //--------------------------------------------------------------------------------
+   // Case 1: ancestor is NIL, i.e. balanceFactor of all ancestors' is '='
+   //--------------------------------------------------------------------------------
+   if(ancestor == NIL)
+   {
+      if(comp(key, N(root).key))       // newNode inserted to left of root
+         N(root).setBalanceFactor('L');
+      else 
+         N(root).setBalanceFactor('R');   // newNode inserted to right of root
+      // Adjust the balanceFactor for all nodes from newNode back up to root
+      adjustBalanceFactors(root, newNode);
+      return;
+   }
+
+   Node &a = N(ancestor);
+
+   //--------------------------------------------------------------------------------
+   // Case 2: Insertion in opposite subtree of ancestor's balance factor, i.e.
+   //  ancestor.balanceFactor = 'L' AND  Insertion made in ancestor's right subtree
+   //     OR
+   //  ancestor.balanceFactor = 'R' AND  Insertion made in ancestor's left subtree
+   //--------------------------------------------------------------------------------
+   if(((a.balanceFactor() == 'L') && !comp(key, a.key)) ||
+        ((a.balanceFactor() == 'R') && comp(key, a.key)))
+   {
+      a.setBalanceFactor('=');
+      // Adjust the balanceFactor for all nodes from newNode back up to ancestor
+      adjustBalanceFactors(ancestor, newNode);
+   }
+   //--------------------------------------------------------------------------------
+   // Case 3: ancestor.balanceFactor = 'R' and the node inserted is
+   //      in the right subtree of ancestor's right child
+   //--------------------------------------------------------------------------------
+   else if((a.balanceFactor() == 'R') && !comp(key, N(a.right).key))
+   {
+      a.setBalanceFactor('='); // Reset ancestor's balanceFactor
+      stats.singleRotation();
+      rotateLeft(ancestor);       // Do single left rotation about ancestor
+      // Adjust the balanceFactor for all nodes from newNode back up to ancestor's parent
+      adjustBalanceFactors(a.parent, newNode);
+   }
+
+   //--------------------------------------------------------------------------------
+   // Case 4: ancestor.balanceFactor is 'L' and the node inserted is
+   //      in the left subtree of ancestor's left child
+   //--------------------------------------------------------------------------------
+   else if((a.balanceFactor() == 'L') && comp(key, N(a.left).key))
+   {
+      a.setBalanceFactor('='); // Reset ancestor's balanceFactor
+      stats.singleRotation();
+      rotateRight(ancestor);       // Do single right rotation about ancestor
+      // Adjust the balanceFactor for all nodes from newNode back up to ancestor's parent
+      adjustBalanceFactors(a.parent, newNode);
+   }
+
+   //--------------------------------------------------------------------------------
+   // Case 5: ancestor.balanceFactor is 'L' and the node inserted is
+   //      in the right subtree of ancestor's left child
+   //--------------------------------------------------------------------------------
+   else if(a.balanceFactor() == 'L')
+   {
+      // Perform double right rotation (actually a left followed by a right)
+      stats.doubleRotation();
+      rotateLeft(a.left);
+      rotateRight(ancestor);
+      // Adjust the balanceFactor for all nodes from newNode back up to ancestor
+      adjustLeftRight(ancestor, newNode);
+   }
+
+   //--------------------------------------------------------------------------------
+   // Case 6: ancestor.balanceFactor is 'R' and the node inserted is 
+   //      in the left subtree of ancestor's right child
+   //--------------------------------------------------------------------------------
+   else
+   {
+      // Perform double left rotation (actually a right followed by a left)
+          stats.doubleRotation();
+          rotateRight(a.right);
+          rotateLeft(ancestor);
+          adjustRightLeft(ancestor, newNode);
+   }
+}
+
+//------------------------------------------------------------------
+// Adjust the balance factor in all nodes from the inserted node's
+//   parent back up to but NOT including a designated end node.
+// @param end– last node back up the tree that needs adjusting
+// @param start – node just inserted 
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::adjustBalanceFactors(NodeIndex end, NodeIndex start)
+{
+    const Key &key = N(start).key;
+    NodeIndex temp = N(start).parent; // Set starting point at start's parent
+    while(temp != end)
+    {
+        if(comp(key, N(temp).key))
+            N(temp).setBalanceFactor('L');
+        else
+            N(temp).setBalanceFactor('R');
+        temp = N(temp).parent;
+    } // end while
+}
+
+//------------------------------------------------------------------
+// rotateLeft()
+// Perform a single rotation left about n.  This will rotate n's
+//   parent to become n's left child.  Then n's left child will
+//   become the former parent's right child.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::rotateLeft(NodeIndex n)
+{
+   Node &nn = N(n);
+   NodeIndex temp = nn.right;   //Hold index of n's right child
+   Node &t = N(temp);
+   nn.right = t.left;      // Move temp 's left child to right child of n
+   if(t.left != NIL)      // If the left child does exist
+      N(t.left).parent = n;// Reset the left child's parent
+   if(nn.parent == NIL)       // If n was the top of its subtree
+   {
+      if(root == n)      // and that subtree is the whole tree
+         root = temp;      // Make temp the new root
+   }
+   else if(N(nn.parent).left == n) // If n was the left child of its' parent
+      N(nn.parent).left = temp;   // Make temp the new left child
+   else               // If n was the right child of its' parent
+      N(nn.parent).right = temp;// Make temp the new right child
+   t.parent = nn.parent;   // temp takes n's place under n's parent
+
+   t.left = n;         // Move n to left child of temp
+   nn.parent = temp;         // Reset n's parent
+
+   updateSubtree(n);         // n is now below temp so fix it first
+   updateSubtree(temp);
+}
+
+//------------------------------------------------------------------
+// rotateRight()
+// Perform a single rotation right about n.  This will rotate n's
+//   parent to become n's right child.  Then n's right child will
+//   become the former parent's left child.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::rotateRight(NodeIndex n)
+{
+   Node &nn = N(n);
+   NodeIndex temp = nn.left;   //Hold index of temp
+   Node &t = N(temp);
+   nn.left = t.right;      // Move temp's right child to left child of n
+   if(t.right != NIL)      // If the right child does exist
+      N(t.right).parent = n;// Reset right child's parent
+   if(nn.parent == NIL)       // If n was the top of its subtree
+   {
+      if(root == n)      // and that subtree is the whole tree
+         root = temp;      // Make temp the root
+   }
+   else if(N(nn.parent).left == n) // If was the left child of its' parent
+      N(nn.parent).left = temp;   // Make temp the new left child
+   else               // If n was the right child of its' parent
+      N(nn.parent).right = temp;// Make temp the new right child
+   t.parent = nn.parent;   // temp takes n's place under n's parent
+
+   t.right = n;         // Move n to right child of temp
+   nn.parent = temp;         // Reset n's parent
+
+   updateSubtree(n);         // n is now below temp so fix it first
+   updateSubtree(temp);
+}
+
+//------------------------------------------------------------------
+// adjustLeftRight()
+// @param end- last node back up the tree that needs adjusting
+// @param start - node just inserted 
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::adjustLeftRight(NodeIndex end, NodeIndex start)
+{
+    NodeIndex pivot = N(end).parent;
+    if(start == pivot)   // start itself became the pivot
+        N(end).setBalanceFactor('=');
+    else if(comp(N(start).key, N(pivot).key))
+    {
+        N(end).setBalanceFactor('R');
+        adjustBalanceFactors(N(pivot).left, start);
+    }
+    else
+    {
+        N(end).setBalanceFactor('=');
+        N(N(pivot).left).setBalanceFactor('L');
+        adjustBalanceFactors(end, start);
+    }
+}
+
+//------------------------------------------------------------------
+// adjustRightLeft
+// @param end- last node back up the tree that needs adjusting
+// @param start - node just inserted 
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::adjustRightLeft(NodeIndex end, NodeIndex start)
+{
+    NodeIndex pivot = N(end).parent;
+    if(start == pivot)   // start itself became the pivot
+        N(end).setBalanceFactor('=');
+    else if(!comp(N(start).key, N(pivot).key))
+    {
+        N(end).setBalanceFactor('L');
+        adjustBalanceFactors(N(pivot).right, start);
+    }
+    else
+    {
+        N(end).setBalanceFactor('=');
+        N(N(pivot).right).setBalanceFactor('R');
+        adjustBalanceFactors(end, start);
+    }
+}
+
+//------------------------------------------------------------------
+// PrintTree()
+// Intiate a recursive traversal to print the tree
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::PrintTree()
+{
+   cout << "\nPrinting the tree...\n";
+   cout << "Root Node: " << N(root).key << " balanceFactor is " <<
+      N(root).balanceFactor() << "\n\n";
+   Print(root);
+}
+
+//------------------------------------------------------------------
+// Print()
+// Perform a recursive traversal to print the tree
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::Print(NodeIndex i)
+{
+   if(i != NIL)
+   {
+      Node &n = N(i);
+      cout<<"Node: " << n.key << " balanceFactor is " <<
+         n.balanceFactor() << "\n";
+      if(n.left != NIL)
+      {
+         cout<<"\t moving left\n";
+         Print(n.left);
+         cout<<"Returning to Node" << n.key << " from its' left subtree\n";
+      }
+      else
+      {
+         cout<<"\t left subtree is empty\n";
+      }
+      cout<<"Node: " << n.key << " balanceFactor is " <<
+         n.balanceFactor() << "\n";
+      if(n.right != NIL)
+      {
+         cout<<"\t moving right\n";
+         Print(n.right);
+         cout<<"Returning to Node" << n.key << " from its' right subtree\n";
+      }
+      else
+      {
+         cout<<"\t right subtree is empty\n";
+      }
+   }
+   
+}
+
+
+// Predecessor
+// node holding the largest key less than key, or nullptr if key is
+// not in the tree or is the smallest key
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::Predecessor(const Key &key) const {
+    NodeIndex node = findIndex(key);
+    if (node == NIL) {
+        return nullptr; // Key not found
+    }
+    return getNode(prevIndex(node));
+}
+
+// Successor
+// node holding the smallest key greater than key, or nullptr if key
+// is not in the tree or is the largest key
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::Successor(const Key &key) const {
+    NodeIndex node = findIndex(key);
+    if (node == NIL) {
+        return nullptr; // Key not found
+    }
+    return getNode(nextIndex(node));
+}
+
+// in-order neighbour of node n, or NIL past either end
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::nextIndex(NodeIndex node) const {
+    if (N(node).right != NIL) {
+        return findMinIndex(N(node).right);
+    }
+    // no right subtree: climb until we arrive from a left child
+    NodeIndex parent = N(node).parent;
+    while (parent != NIL && N(parent).right == node) {
+        node = parent;
+        parent = N(parent).parent;
+    }
+    return parent;
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::prevIndex(NodeIndex node) const {
+    if (N(node).left != NIL) {
+        return findMaxIndex(N(node).left);
+    }
+    // no left subtree: climb until we arrive from a right child
+    NodeIndex parent = N(node).parent;
+    while (parent != NIL && N(parent).left == node) {
+        node = parent;
+        parent = N(parent).parent;
+    }
+    return parent;
+}
+
+// search
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::search(const Key &key) const {
+    NodeIndex current = findIndex(key);
+    return (current == NIL) ? nullptr : &N(current);
+}
+
+// index of the node holding key, or NIL
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::findIndex(const Key &key) const {
+    NodeIndex current = root;
+    stats.search();
+    while (current != NIL) {
+        const Node &n = N(current);
+        stats.comparison();
+        if (comp(key, n.key)) {
+            current = n.left;
+            continue;
+        }
+        stats.comparison();
+        if (comp(n.key, key)) {
+            current = n.right;
+        } else {
+            return current; // Key found
+        }
+    }
+    return NIL; // Key not found
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::getRoot() const {
+    return (root == NIL) ? nullptr : &N(root);
+}
+
+// resolve a left/right/parent index to its node (nullptr for NIL)
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::getNode(NodeIndex i) const {
+    return (i == NIL) ? nullptr : &N(i);
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::Delete(const Key &key) {
+    NodeIndex nodeToDelete = findIndex(key);
+    if (nodeToDelete == NIL) {
+        return; // if node dne
+    }
+
+    // if node has 2 children, move the predecessor's data up and
+    // remove the predecessor node instead (it has at most one child)
+    if (N(nodeToDelete).left != NIL && N(nodeToDelete).right != NIL) {
+        NodeIndex predecessor = findMaxIndex(N(nodeToDelete).left); // find predecessor
+        N(nodeToDelete).key = N(predecessor).key; // copy predecessor data to node
+        N(nodeToDelete).secondValue = N(predecessor).secondValue;
+        nodeToDelete = predecessor;
+    }
+
+    // node now has at most one child
+    if (nodeToDelete == maxFinger) {
+        maxFinger = NIL; // found again by the next Insert
+    }
+    Node &d = N(nodeToDelete);
+    NodeIndex child = (d.left != NIL) ? d.left : d.right;
+    NodeIndex parent = d.parent;
+    bool fromLeft = false; // which side of parent lost height
+    if (child != NIL) {
+        N(child).parent = parent;
+    }
+    if (parent == NIL) { // node = root
+        root = child;
+    } else if (nodeToDelete == N(parent).left) {
+        N(parent).left = child;
+        fromLeft = true;
+    } else {
+        N(parent).right = child;
+    }
+    pool->Release(nodeToDelete);
+
+    // every ancestor of the removed node lost one descendant (and
+    // maybe the value moved up into nodeToDelete's old slot)
+    for (NodeIndex current = parent; current != NIL; current = N(current).parent) {
+        if (is_same<Augment, NoAugment>::value) {
+            N(current).setSize(N(current).size() - 1);
+        } else {
+            updateSubtree(current);
+        }
+    }
+
+    // rebalance tree from the parent of the deleted node up to the root
+    retraceDelete(parent, fromLeft);
+}
+
+//------------------------------------------------------------------
+// retraceDelete()
+// Walk back up from the parent of a removed node, fixing balance
+//  factors and rotating where a subtree became two levels lighter on
+//  one side. Stops as soon as a subtree keeps its old height.
+// @param current - parent of the removed node
+// @param fromLeft - true if current's left subtree got shorter
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::retraceDelete(NodeIndex current, bool fromLeft)
+{
+   while(current != NIL)
+   {
+      stats.deleteRetrace();
+      Node &c = N(current);
+      NodeIndex top = current;   // root of this subtree after any rotation
+      char shorter = fromLeft ? 'L' : 'R';   // side that lost height
+      char taller = fromLeft ? 'R' : 'L';
+
+      if(c.balanceFactor() == shorter)   // was heavy on the short side
+      {
+         c.setBalanceFactor('=');       // now even, but one level shorter
+      }
+      else if(c.balanceFactor() == '=')  // was even
+      {
+         c.setBalanceFactor(taller);    // now leans, height unchanged
+         return;
+      }
+      else   // was already heavy on the other side: rotate
+      {
+         stats.deleteRotation();
+         NodeIndex sibling = fromLeft ? c.right : c.left;
+         Node &s = N(sibling);
+         if(s.balanceFactor() != shorter)
+         {
+            // Single rotation toward the short side
+            if(fromLeft)
+               rotateLeft(current);
+            else
+               rotateRight(current);
+            top = sibling;
+            if(s.balanceFactor() == '=')   // height unchanged, done
+            {
+               c.setBalanceFactor(taller);
+               s.setBalanceFactor(shorter);
+               return;
+            }
+            c.setBalanceFactor('=');
+            s.setBalanceFactor('=');
+         }
+         else
+         {
+            // Double rotation through the sibling's inner child
+            NodeIndex inner = fromLeft ? s.left : s.right;
+            Node &g = N(inner);
+            if(fromLeft)
+            {
+               rotateRight(sibling);
+               rotateLeft(current);
+            }
+            else
+            {
+               rotateLeft(sibling);
+               rotateRight(current);
+            }
+            c.setBalanceFactor((g.balanceFactor() == taller) ? shorter : '=');
+            s.setBalanceFactor((g.balanceFactor() == shorter) ? taller : '=');
+            g.setBalanceFactor('=');
+            top = inner;
+         }
+      }
+
+      // The subtree rooted at top is one level shorter; move up
+      NodeIndex parent = N(top).parent;
+      if(parent != NIL)
+         fromLeft = (N(parent).left == top);
+      current = parent;
+   }
+}
+
+// node holding the largest key, or nullptr if the tree is empty
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::findMax() const {
+    return (root == NIL) ? nullptr : &N(findMaxIndex(root));
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::findMaxIndex(NodeIndex node) const {
+    if (node == NIL) {
+        return NIL; // return NIL if empty
+    }
+    // go down to largest value (rightmost)
+    while (N(node).right != NIL) {
+        node = N(node).right;
+    }
+    return node; 
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::findMinIndex(NodeIndex node) const {
+    if (node == NIL) {
+        return NIL; // return NIL if empty
+    }
+    // go down to smallest value (leftmost)
+    while (N(node).left != NIL) {
+        node = N(node).left;
+    }
+    return node; 
+}
+
+// size of the subtree rooted at n (0 for an empty subtree)
+template <class Key, class Value, class Compare, class Stats, class Augment>
+uint32_t AVL_Tree<Key, Value, Compare, Stats, Augment>::subtreeSize(NodeIndex n) const {
+    return (n == NIL) ? 0 : N(n).size();
+}
+
+// summary of the subtree rooted at n (the identity for an empty subtree)
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename Augment::Summary AVL_Tree<Key, Value, Compare, Stats, Augment>::summaryOf(NodeIndex n) const {
+    return (n == NIL) ? Augment::identity() : N(n).summary;
+}
+
+// recompute n's subtree size and summary from its children
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::updateSubtree(NodeIndex n) {
+    Node &node = N(n);
+    node.setSize(1 + subtreeSize(node.left) + subtreeSize(node.right));
+    node.summary = Augment::combine(Augment::combine(summaryOf(node.left), Augment::lift(node.secondValue)),
+                                    summaryOf(node.right));
+}
+
+// number of nodes in the tree
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::Size() const {
+    return subtreeSize(root);
+}
+
+// select
+// return the node holding the rank-th smallest key (1-based), or
+// nullptr if rank is out of range. O(log n) using subtree sizes.
+template <class Key, class Value, class Compare, class Stats, class Augment>
+AVLTreeNode<Key, Value, typename Augment::Summary>* AVL_Tree<Key, Value, Compare, Stats, Augment>::select(int rank) const {
+    return getNode(selectIndex(rank));
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::selectIndex(int rank) const {
+    if (rank < 1 || rank > Size()) {
+        return NIL;
+    }
+    uint32_t remaining = rank;
+    NodeIndex current = root;
+    while (current != NIL) {
+        uint32_t leftSize = subtreeSize(N(current).left);
+        if (remaining <= leftSize) {
+            current = N(current).left;
+        } else if (remaining == leftSize + 1) {
+            return current;
+        } else {
+            remaining -= leftSize + 1;
+            current = N(current).right;
+        }
+    }
+    return NIL;
+}
+
+// rank_of
+// return the 1-based rank of key among all keys in ascending order,
+// or -1 if key is not in the tree. O(log n) using subtree sizes.
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::rank_of(const Key &key) const {
+    NodeIndex current = root;
+    int smaller = 0; // keys known to be less than key
+    while (current != NIL) {
+        const Node &n = N(current);
+        if (comp(key, n.key)) {
+            current = n.left;
+        } else if (comp(n.key, key)) {
+            smaller += subtreeSize(n.left) + 1;
+            current = n.right;
+        } else {
+            return smaller + subtreeSize(n.left) + 1;
+        }
+    }
+    return -1; // Key not found
+}
+
+// count_less
+// number of keys strictly less than key, whether or not key is in
+// the tree. O(log n) using subtree sizes.
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::count_less(const Key &key) const {
+    NodeIndex current = root;
+    int smaller = 0;
+    while (current != NIL) {
+        const Node &n = N(current);
+        if (comp(n.key, key)) {
+            smaller += subtreeSize(n.left) + 1;
+            current = n.right;
+        } else {
+            current = n.left;
+        }
+    }
+    return smaller;
+}
+
+// begin / end
+// in-order iteration from the smallest key; end() is one past the
+// largest
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::begin() const {
+    return iterator(this, findMinIndex(root));
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::end() const {
+    return iterator(this, NIL);
+}
+
+// reverse iteration from the largest key
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::reverse_iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::rbegin() const {
+    return reverse_iterator(end());
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::reverse_iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::rend() const {
+    return reverse_iterator(begin());
+}
+
+// iterator at key, or end() if key is not in the tree
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::find(const Key &key) const {
+    return iterator(this, findIndex(key));
+}
+
+// lower_bound
+// first position whose key is not less than key
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::lower_bound(const Key &key) const {
+    NodeIndex current = root, best = NIL;
+    while (current != NIL) {
+        if (comp(N(current).key, key)) {
+            current = N(current).right;
+        } else {
+            best = current;
+            current = N(current).left;
+        }
+    }
+    return iterator(this, best);
+}
+
+// upper_bound
+// first position whose key is greater than key
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::upper_bound(const Key &key) const {
+    NodeIndex current = root, best = NIL;
+    while (current != NIL) {
+        if (comp(key, N(current).key)) {
+            best = current;
+            current = N(current).left;
+        } else {
+            current = N(current).right;
+        }
+    }
+    return iterator(this, best);
+}
+
+// range
+// every node with lo <= key < hi, for use in a range-based for loop
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::Range AVL_Tree<Key, Value, Compare, Stats, Augment>::range(const Key &lo, const Key &hi) const {
+    Range r;
+    r.first = lower_bound(lo);
+    r.last = lower_bound(hi);
+    if (comp(hi, lo)) {
+        r.first = r.last; // empty range
+    }
+    return r;
+}
+
+// at_rank
+// iterator at the rank-th smallest key (1-based), or end()
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::at_rank(int rank) const {
+    return iterator(this, selectIndex(rank));
+}
+
+//------------------------------------------------------------------
+// Clear()
+// Remove every node. An owned pool drops all of its slabs at once;
+//  in a shared pool the nodes go back on the free list one by one.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::Clear()
+{
+   if(pool == &ownPool)
+      pool->Reset();
+   else
+      releaseSubtree(root);
+   root = NIL;
+   maxFinger = NIL;
+}
+
+//------------------------------------------------------------------
+// Clear(deferred)
+// Empty the tree, leaving the freeing to deferred (see reclaimer.h):
+//  a tree with its own pool hands over its few slabs whatever its
+//  size. Nodes in a
+//  shared pool still go back to its free list here, since the pool's
+//  other trees keep allocating from it.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+template <class Reclaimer>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::Clear(Reclaimer &deferred)
+{
+   if(pool == &ownPool)
+      pool->Reset(deferred);
+   else
+      releaseSubtree(root);
+   root = NIL;
+   maxFinger = NIL;
+}
+
+//------------------------------------------------------------------
+// releaseSubtree()
+// Return every node under n to the pool's free list.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::releaseSubtree(NodeIndex n)
+{
+   if(n != NIL)
+   {
+      releaseSubtree(N(n).left);
+      releaseSubtree(N(n).right);
+      pool->Release(n);
+   }
+}
+
+//------------------------------------------------------------------
+// build_from_sorted()
+// Replace the tree's contents with items, which must already be in
+//  ascending key order. Builds a perfectly balanced tree in O(n) with
+//  sizes and balance factors set directly, so no rotations happen.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::build_from_sorted(const vector<pair<Key, Value> > &items)
+{
+   int height;
+   Clear();
+   root = buildBalanced(items, 0, items.size(), NIL, height);
+}
+
+//------------------------------------------------------------------
+// buildBalanced()
+// Build a subtree from items[lo, hi) rooted at the middle item and
+//  return its index. height is set to the subtree's height so the
+//  caller can derive its own balance factor.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::buildBalanced(const vector<pair<Key, Value> > &items,
+                                                       size_t lo, size_t hi, NodeIndex parent, int &height)
+{
+   if(lo >= hi)
+   {
+      height = 0;
+      return NIL;
+   }
+   size_t mid = lo + (hi - lo) / 2;
+   NodeIndex i = pool->Allocate();
+   Node &n = N(i);
+   n.key = items[mid].first;
+   n.secondValue = items[mid].second;
+   n.parent = parent;
+   n.sizeAndBalance = 0;
+
+   int leftHeight, rightHeight;
+   n.left = buildBalanced(items, lo, mid, i, leftHeight);
+   n.right = buildBalanced(items, mid + 1, hi, i, rightHeight);
+   updateSubtree(i);
+   if(leftHeight > rightHeight)
+      n.setBalanceFactor('L');
+   else if(rightHeight > leftHeight)
+      n.setBalanceFactor('R');
+   else
+      n.setBalanceFactor('=');
+   height = 1 + max(leftHeight, rightHeight);
+   return i;
+}
+
+//------------------------------------------------------------------
+// collect_sorted()
+// Append every (key, value) pair to out in ascending key order using
+//  the parent links, so no recursion or stack is needed.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::collect_sorted(vector<pair<Key, Value> > &out) const
+{
+   out.reserve(out.size() + Size());
+   for(NodeIndex current = findMinIndex(root); current != NIL; current = nextIndex(current))
+      out.push_back(make_pair(N(current).key, N(current).secondValue));
+}
+
+//------------------------------------------------------------------
+// copy_from()
+// Replace this tree's contents with a copy of other that keeps its
+//  exact shape, sizes and balance factors. O(n), no rotations.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::copy_from(const AVL_Tree &other)
+{
+   if(&other == this)
+      return;
+   Clear();
+   root = copySubtree(other, other.root, NIL);
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::copySubtree(const AVL_Tree &other, NodeIndex src, NodeIndex parent)
+{
+   if(src == NIL)
+      return NIL;
+   NodeIndex i = pool->Allocate();
+   const Node &from = other.N(src);
+   Node &n = N(i);
+   n.key = from.key;
+   n.secondValue = from.secondValue;
+   n.sizeAndBalance = from.sizeAndBalance;
+   n.summary = from.summary;
+   n.parent = parent;
+   n.left = copySubtree(other, from.left, i);
+   n.right = copySubtree(other, from.right, i);
+   return i;
+}
+
+// the pool this tree's nodes live in, for building trees that share it
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodePool<AVLTreeNode<Key, Value, typename Augment::Summary> >* AVL_Tree<Key, Value, Compare, Stats, Augment>::node_pool() const
+{
+   return pool;
+}
+
+//------------------------------------------------------------------
+// retraceInsert()
+// Walk up from the parent of a subtree that just grew one level,
+//  fixing balance factors and rotating where needed, the insertion
+//  counterpart of retraceDelete(). Unlike a plain insert, a join can
+//  leave the heavy child even, which takes a single rotation that
+//  keeps the growth going.
+// @param current - parent of the subtree that grew
+// @param fromLeft - true if current's left subtree grew
+// @return true if the growth reached the top of the subtree
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+bool AVL_Tree<Key, Value, Compare, Stats, Augment>::retraceInsert(NodeIndex current, bool fromLeft)
+{
+   while(current != NIL)
+   {
+      Node &c = N(current);
+      NodeIndex top = current;   // root of this subtree after any rotation
+      char grown = fromLeft ? 'L' : 'R';   // side that gained height
+      char other = fromLeft ? 'R' : 'L';
+
+      if(c.balanceFactor() == other)   // was heavy on the other side
+      {
+         c.setBalanceFactor('=');     // now even, height unchanged
+         return false;
+      }
+      else if(c.balanceFactor() == '=')
+      {
+         c.setBalanceFactor(grown);   // now leans, one level taller
+      }
+      else   // already heavy on the grown side: rotate
+      {
+         NodeIndex child = fromLeft ? c.left : c.right;
+         Node &ch = N(child);
+         if(ch.balanceFactor() != other)
+         {
+            // Single rotation away from the grown side
+            stats.singleRotation();
+            if(fromLeft)
+               rotateRight(current);
+            else
+               rotateLeft(current);
+            if(ch.balanceFactor() == grown)   // back to the old height
+            {
+               c.setBalanceFactor('=');
+               ch.setBalanceFactor('=');
+               return false;
+            }
+            c.setBalanceFactor(grown);
+            ch.setBalanceFactor(other);
+            top = child;
+         }
+         else
+         {
+            // Double rotation through the child's inner grandchild
+            stats.doubleRotation();
+            NodeIndex inner = fromLeft ? ch.right : ch.left;
+            Node &g = N(inner);
+            if(fromLeft)
+            {
+               rotateLeft(child);
+               rotateRight(current);
+            }
+            else
+            {
+               rotateRight(child);
+               rotateLeft(current);
+            }
+            c.setBalanceFactor((g.balanceFactor() == grown) ? other : '=');
+            ch.setBalanceFactor((g.balanceFactor() == other) ? grown : '=');
+            g.setBalanceFactor('=');
+            return false;
+         }
+      }
+
+      // The subtree rooted at top is one level taller; move up
+      NodeIndex parent = N(top).parent;
+      if(parent != NIL)
+         fromLeft = (N(parent).left == top);
+      current = parent;
+   }
+   return true;
+}
+
+// height of the subtree at n, found by always stepping to the taller child
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::heightOf(NodeIndex n) const
+{
+   int height = 0;
+   while(n != NIL)
+   {
+      height++;
+      n = (N(n).balanceFactor() == 'L') ? N(n).left : N(n).right;
+   }
+   return height;
+}
+
+// heights of n's children, given n's own height and balance factor
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::leftHeight(NodeIndex n, int height) const
+{
+   return (N(n).balanceFactor() == 'R') ? height - 2 : height - 1;
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+int AVL_Tree<Key, Value, Compare, Stats, Augment>::rightHeight(NodeIndex n, int height) const
+{
+   return (N(n).balanceFactor() == 'L') ? height - 2 : height - 1;
+}
+
+//------------------------------------------------------------------
+// joinNodes()
+// Join detached subtrees l < m < r into one AVL subtree. When the
+//  heights differ by more than one, m is hung off the taller side's
+//  spine at the matching height and the path is retraced, so the cost
+//  is O(|hl - hr| + 1).
+// @param m - a single detached node
+// @param height - set to the height of the joined subtree
+// @return root of the joined subtree
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::joinNodes(NodeIndex l, int hl, NodeIndex m, NodeIndex r, int hr, int &height)
+{
+   Node &mid = N(m);
+   mid.sizeAndBalance = 0;
+   if(hl <= hr + 1 && hr <= hl + 1)
+   {
+      // Heights are close: m simply becomes the new root
+      mid.left = l;
+      mid.right = r;
+      mid.parent = NIL;
+      if(l != NIL)
+         N(l).parent = m;
+      if(r != NIL)
+         N(r).parent = m;
+      mid.setBalanceFactor((hl > hr) ? 'L' : (hr > hl) ? 'R' : '=');
+      updateSubtree(m);
+      height = 1 + max(hl, hr);
+      return m;
+   }
+
+   bool leftTaller = (hl > hr);
+   NodeIndex top = leftTaller ? l : r;
+   int hTall = leftTaller ? hl : hr;
+   int hShort = leftTaller ? hr : hl;
+
+   // Walk down the inner spine of the taller tree to height hShort + 1
+   NodeIndex c = top;
+   int hc = hTall;
+   while(hc > hShort + 1)
+   {
+      if(leftTaller)
+      {
+         hc = rightHeight(c, hc);
+         c = N(c).right;
+      }
+      else
+      {
+         hc = leftHeight(c, hc);
+         c = N(c).left;
+      }
+   }
+   NodeIndex p = (c != NIL) ? N(c).parent : NIL;
+   if(p == NIL)   // c was NIL: its parent is the last spine node
+   {
+      p = top;
+      while(leftTaller ? N(p).right != NIL : N(p).left != NIL)
+         p = leftTaller ? N(p).right : N(p).left;
+   }
+
+   // m takes c's place with c and the shorter tree as its children
+   if(leftTaller)
+   {
+      mid.left = c;
+      mid.right = r;
+      N(p).right = m;
+   }
+   else
+   {
+      mid.left = l;
+      mid.right = c;
+      N(p).left = m;
+   }
+   mid.parent = p;
+   if(mid.left != NIL)
+      N(mid.left).parent = m;
+   if(mid.right != NIL)
+      N(mid.right).parent = m;
+   if(hc == hShort)
+      mid.setBalanceFactor('=');
+   else
+      mid.setBalanceFactor(leftTaller ? 'L' : 'R');
+   updateSubtree(m);
+
+   // m's subtree is one level taller than c was
+   bool grew = retraceInsert(p, !leftTaller);
+   NodeIndex n = m;
+   for(NodeIndex up = N(m).parent; up != NIL; up = N(up).parent)
+   {
+      updateSubtree(up);
+      n = up;
+   }
+   height = hTall + (grew ? 1 : 0);
+   return n;
+}
+
+//------------------------------------------------------------------
+// splitNodes()
+// Split detached subtree t around key into l (keys < key) and r
+//  (keys > key). O(log n): each level does one join whose cost is the
+//  height difference of its inputs, and those telescope.
+// @return the detached node holding key, or NIL if key is absent
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::splitNodes(NodeIndex t, int ht, const Key &key,
+                                                    NodeIndex &l, int &hl, NodeIndex &r, int &hr)
+{
+   if(t == NIL)
+   {
+      l = r = NIL;
+      hl = hr = 0;
+      return NIL;
+   }
+   Node &n = N(t);
+   NodeIndex a = n.left, b = n.right;
+   int ha = leftHeight(t, ht), hb = rightHeight(t, ht);
+   if(a != NIL)
+      N(a).parent = NIL;
+   if(b != NIL)
+      N(b).parent = NIL;
+
+   if(comp(key, n.key))
+   {
+      NodeIndex r1;
+      int hr1;
+      NodeIndex found = splitNodes(a, ha, key, l, hl, r1, hr1);
+      r = joinNodes(r1, hr1, t, b, hb, hr);
+      return found;
+   }
+   else if(comp(n.key, key))
+   {
+      NodeIndex l1;
+      int hl1;
+      NodeIndex found = splitNodes(b, hb, key, l1, hl1, r, hr);
+      l = joinNodes(a, ha, t, l1, hl1, hl);
+      return found;
+   }
+   l = a;
+   hl = ha;
+   r = b;
+   hr = hb;
+   n.left = n.right = n.parent = NIL;
+   return t;
+}
+
+// detach the largest node of t and return it; rest is what remains
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::splitLast(NodeIndex t, int ht, NodeIndex &rest, int &hrest)
+{
+   Node &n = N(t);
+   NodeIndex a = n.left, b = n.right;
+   int ha = leftHeight(t, ht), hb = rightHeight(t, ht);
+   if(a != NIL)
+      N(a).parent = NIL;
+   if(b == NIL)
+   {
+      rest = a;
+      hrest = ha;
+      n.left = n.parent = NIL;
+      return t;
+   }
+   N(b).parent = NIL;
+   NodeIndex r1;
+   int hr1;
+   NodeIndex last = splitLast(b, hb, r1, hr1);
+   rest = joinNodes(a, ha, t, r1, hr1, hrest);
+   return last;
+}
+
+// join l < r with no middle key by promoting the largest key of l
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::join2(NodeIndex l, int hl, NodeIndex r, int hr, int &height)
+{
+   if(l == NIL)
+   {
+      height = hr;
+      return r;
+   }
+   NodeIndex rest;
+   int hrest;
+   NodeIndex last = splitLast(l, hl, rest, hrest);
+   return joinNodes(rest, hrest, last, r, hr, height);
+}
+
+//------------------------------------------------------------------
+// unionNodes()
+// Divide-and-conquer union: split t2 around t1's root key, union the
+//  two halves on each side, and join the results back around the
+//  root. The two recursive unions touch disjoint nodes, so while
+//  depth > 0 one of them runs on another thread.
+// @param combine - called as combine(kept, dropped) on equal keys
+// @param discards - collects the dropped duplicate nodes
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+template <class Combine>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::unionNodes(NodeIndex t1, int h1, NodeIndex t2, int h2, int &height,
+                                                    Combine &combine, vector<NodeIndex> &discards, int depth)
+{
+   if(t1 == NIL)
+   {
+      height = h2;
+      return t2;
+   }
+   if(t2 == NIL)
+   {
+      height = h1;
+      return t1;
+   }
+   Node &k = N(t1);
+   NodeIndex a = k.left, b = k.right;
+   int ha = leftHeight(t1, h1), hb = rightHeight(t1, h1);
+   if(a != NIL)
+      N(a).parent = NIL;
+   if(b != NIL)
+      N(b).parent = NIL;
+   k.left = k.right = k.parent = NIL;
+
+   NodeIndex l2, r2;
+   int hl2, hr2;
+   NodeIndex found = splitNodes(t2, h2, k.key, l2, hl2, r2, hr2);
+   if(found != NIL)
+   {
+      combine(k.secondValue, N(found).secondValue);
+      discards.push_back(found);
+   }
+
+   static const uint32_t PARALLEL_CUTOFF = 4096;   // nodes worth a thread
+   NodeIndex tl, tr;
+   int hl, hr;
+   if(depth > 0 && subtreeSize(a) + subtreeSize(l2) >= PARALLEL_CUTOFF &&
+      subtreeSize(b) + subtreeSize(r2) >= PARALLEL_CUTOFF)
+   {
+      vector<NodeIndex> rightDiscards;
+      future<void> left = async(launch::async, [&]() {
+         tl = unionNodes(a, ha, l2, hl2, hl, combine, discards, depth - 1);
+      });
+      tr = unionNodes(b, hb, r2, hr2, hr, combine, rightDiscards, depth - 1);
+      left.get();
+      discards.insert(discards.end(), rightDiscards.begin(), rightDiscards.end());
+   }
+   else
+   {
+      tl = unionNodes(a, ha, l2, hl2, hl, combine, discards, 0);
+      tr = unionNodes(b, hb, r2, hr2, hr, combine, discards, 0);
+   }
+   return joinNodes(tl, hl, t1, tr, hr, height);
+}
+
+//------------------------------------------------------------------
+// unionRange()
+// Union the detached subtrees roots[lo, hi) by splitting the range in
+//  half, merging each half (in parallel while depth > 0) and taking
+//  the union of the two results.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+template <class Combine>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::unionRange(const vector<NodeIndex> &roots, size_t lo, size_t hi, int &height,
+                                                    Combine &combine, vector<NodeIndex> &discards, int depth)
+{
+   if(hi - lo == 1)
+   {
+      height = heightOf(roots[lo]);
+      return roots[lo];
+   }
+   size_t mid = lo + (hi - lo) / 2;
+   NodeIndex l, r;
+   int hl, hr;
+   if(depth > 0)
+   {
+      vector<NodeIndex> rightDiscards;
+      future<void> left = async(launch::async, [&]() {
+         l = unionRange(roots, lo, mid, hl, combine, discards, depth - 1);
+      });
+      r = unionRange(roots, mid, hi, hr, combine, rightDiscards, depth - 1);
+      left.get();
+      discards.insert(discards.end(), rightDiscards.begin(), rightDiscards.end());
+   }
+   else
+   {
+      l = unionRange(roots, lo, mid, hl, combine, discards, 0);
+      r = unionRange(roots, mid, hi, hr, combine, discards, 0);
+   }
+   return unionNodes(l, hl, r, hr, height, combine, discards, depth);
+}
+
+//------------------------------------------------------------------
+// differenceNodes()
+// Remove from detached subtree t1 every key found in other's subtree
+//  t2. other is only read, so it may live in any pool.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+NodeIndex AVL_Tree<Key, Value, Compare, Stats, Augment>::differenceNodes(NodeIndex t1, int h1, const AVL_Tree &other, NodeIndex t2,
+                                                         int &height, vector<NodeIndex> &discards)
+{
+   if(t1 == NIL || t2 == NIL)
+   {
+      height = h1;
+      return t1;
+   }
+   const Node &o = other.N(t2);
+   NodeIndex l, r;
+   int hl, hr;
+   NodeIndex found = splitNodes(t1, h1, o.key, l, hl, r, hr);
+   if(found != NIL)
+      discards.push_back(found);
+   l = differenceNodes(l, hl, other, o.left, hl, discards);
+   r = differenceNodes(r, hr, other, o.right, hr, discards);
+   return join2(l, hl, r, hr, height);
+}
+
+//------------------------------------------------------------------
+// join()
+// Make this tree hold every key of left, then key, then every key of
+//  right; left and right are left empty. All keys of left must be
+//  less than key and all keys of right greater. This tree must be
+//  empty or be left or right itself, and all three must share a pool.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::join(AVL_Tree &left, const Key &key, const Value &value, AVL_Tree &right)
+{
+   NodeIndex l = left.root, r = right.root;
+   left.root = NIL;
+   left.maxFinger = NIL;
+   right.root = NIL;
+   right.maxFinger = NIL;
+   root = NIL;
+   maxFinger = NIL;
+
+   NodeIndex m = pool->Allocate();
+   N(m).key = key;
+   N(m).secondValue = value;
+   int height;
+   root = joinNodes(l, heightOf(l), m, r, heightOf(r), height);
+}
+
+//------------------------------------------------------------------
+// split()
+// Move every key less than key into left and every greater key into
+//  right, leaving this tree empty. left and right must be empty and
+//  share this tree's pool. A node holding key itself is released.
+// @return true if key was in the tree
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+bool AVL_Tree<Key, Value, Compare, Stats, Augment>::split(const Key &key, AVL_Tree &left, AVL_Tree &right)
+{
+   NodeIndex t = root;
+   root = NIL;
+   maxFinger = NIL;
+   NodeIndex l, r;
+   int hl, hr;
+   NodeIndex found = splitNodes(t, heightOf(t), key, l, hl, r, hr);
+   left.root = l;
+   left.maxFinger = NIL;
+   right.root = r;
+   right.maxFinger = NIL;
+   if(found != NIL)
+      pool->Release(found);
+   return found != NIL;
+}
+
+//------------------------------------------------------------------
+// union_with()
+// Move every key of other into this tree, leaving other empty. On
+//  equal keys this tree's value is kept, or combine(kept, dropped)
+//  decides. Trees sharing a pool are merged purely by split and join;
+//  otherwise other's nodes are first copied into this pool in O(m).
+// @param threads - run the top levels of the recursion on up to this
+//                  many threads
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::union_with(AVL_Tree &other, int threads)
+{
+   union_with(other, [](Value &, const Value &) {}, threads);
+}
+
+template <class Key, class Value, class Compare, class Stats, class Augment>
+template <class Combine>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::union_with(AVL_Tree &other, Combine combine, int threads)
+{
+   if(&other == this)
+      return;
+   NodeIndex t2;
+   if(other.pool == pool)
+      t2 = other.root;
+   else
+   {
+      t2 = copySubtree(other, other.root, NIL);
+      other.Clear();
+   }
+   other.root = NIL;
+   other.maxFinger = NIL;
+
+   int depth = 0;
+   while((1 << depth) < threads)
+      depth++;
+
+   // root stays NIL while subtrees are detached so that concurrent
+   //  rotations never write it
+   NodeIndex t1 = root;
+   root = NIL;
+   maxFinger = NIL;
+   vector<NodeIndex> discards;
+   int height;
+   root = unionNodes(t1, heightOf(t1), t2, heightOf(t2), height, combine, discards, depth);
+   for(size_t i = 0; i < discards.size(); i++)
+      pool->Release(discards[i]);
+}
+
+//------------------------------------------------------------------
+// difference_with()
+// Remove every key that also appears in other.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::difference_with(const AVL_Tree &other)
+{
+   if(&other == this)
+   {
+      Clear();
+      return;
+   }
+   NodeIndex t1 = root;
+   root = NIL;
+   maxFinger = NIL;
+   vector<NodeIndex> discards;
+   int height;
+   root = differenceNodes(t1, heightOf(t1), other, other.root, height, discards);
+   for(size_t i = 0; i < discards.size(); i++)
+      pool->Release(discards[i]);
+}
+
+//------------------------------------------------------------------
+// union_all()
+// Add a copy of every tree in trees to this one, calling
+//  combine(kept, dropped) on equal keys. The copies are made serially
+//  into this tree's pool, then merged pairwise by a divide-and-conquer
+//  union whose top levels run on up to threads threads.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+template <class Combine>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::union_all(const vector<AVL_Tree*> &trees, Combine combine, int threads)
+{
+   vector<NodeIndex> roots;
+   roots.reserve(trees.size() + 1);
+   roots.push_back(root);
+   root = NIL;
+   maxFinger = NIL;
+   for(size_t i = 0; i < trees.size(); i++)
+      if(trees[i] != this)
+         roots.push_back(copySubtree(*trees[i], trees[i]->root, NIL));
+
+   int depth = 0;
+   while((1 << depth) < threads)
+      depth++;
+
+   vector<NodeIndex> discards;
+   int height;
+   root = unionRange(roots, 0, roots.size(), height, combine, discards, depth);
+   for(size_t i = 0; i < discards.size(); i++)
+      pool->Release(discards[i]);
+}
+
+// freeze
+// read-only copy of the current contents in a cache-friendly layout;
+// later changes to this tree do not reach it
+template <class Key, class Value, class Compare, class Stats, class Augment>
+FrozenTree<Key, Value, Compare> AVL_Tree<Key, Value, Compare, Stats, Augment>::freeze() const {
+    vector<pair<Key, Value> > items;
+    collect_sorted(items);
+    FrozenTree<Key, Value, Compare> frozen;
+    frozen.build(items);
+    return frozen;
+}
+
+// collect_stats
+// add this tree's counters, node count and height into out
+template <class Key, class Value, class Compare, class Stats, class Augment>
+void AVL_Tree<Key, Value, Compare, Stats, Augment>::collect_stats(TreeStats &out) const {
+    TreeStats mine;
+    stats.addTo(mine);
+    mine.nodes = Size();
+    mine.height = heightOf(root);
+    out += mine;
+}
+
+//------------------------------------------------------------------
+// range_aggregate()
+// Summary of the values whose keys fall in [lo, hi). Descends to the
+//  first node inside the range, then follows the lo boundary down its
+//  left side and the hi boundary down its right side, taking whole
+//  subtree summaries along the way: O(log n).
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename Augment::Summary AVL_Tree<Key, Value, Compare, Stats, Augment>::range_aggregate(const Key &lo, const Key &hi) const
+{
+   NodeIndex split = root;
+   while(split != NIL)
+   {
+      if(comp(N(split).key, lo))
+         split = N(split).right;
+      else if(!comp(N(split).key, hi))
+         split = N(split).left;
+      else
+         break;
+   }
+   if(split == NIL)
+      return Augment::identity();
+
+   // keys >= lo in the left subtree, combined right to left
+   Summary left = Augment::identity();
+   for(NodeIndex n = N(split).left; n != NIL; )
+   {
+      if(comp(N(n).key, lo))
+         n = N(n).right;
+      else
+      {
+         left = Augment::combine(Augment::combine(Augment::lift(N(n).secondValue), summaryOf(N(n).right)), left);
+         n = N(n).left;
+      }
+   }
+   // keys < hi in the right subtree, combined left to right
+   Summary right = Augment::identity();
+   for(NodeIndex n = N(split).right; n != NIL; )
+   {
+      if(comp(N(n).key, hi))
+      {
+         right = Augment::combine(right, Augment::combine(summaryOf(N(n).left), Augment::lift(N(n).secondValue)));
+         n = N(n).right;
+      }
+      else
+         n = N(n).left;
+   }
+   return Augment::combine(Augment::combine(left, Augment::lift(N(split).secondValue)), right);
+}
+
+//------------------------------------------------------------------
+// update()
+// Replace key's value in place and refresh the summaries on the path
+//  above it. Nothing moves, so this is one descent and one climb with
+//  no rotations. Returns false if key is not in the tree.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+bool AVL_Tree<Key, Value, Compare, Stats, Augment>::update(const Key &key, const Value &value)
+{
+   NodeIndex n = findIndex(key);
+   if(n == NIL)
+      return false;
+   N(n).secondValue = value;
+   if(!is_same<Augment, NoAugment>::value)
+   {
+      for(; n != NIL; n = N(n).parent)
+         updateSubtree(n);
+   }
+   return true;
+}
+
+// aggregate
+// summary of every value in the tree, kept at the root: O(1)
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename Augment::Summary AVL_Tree<Key, Value, Compare, Stats, Augment>::aggregate() const
+{
+   return summaryOf(root);
+}
+
+//------------------------------------------------------------------
+// aggregate_less()
+// Summary of the values whose keys are less than key, whether or not
+//  key is in the tree. Like count_less(), with summaries in place of
+//  subtree sizes: O(log n).
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename Augment::Summary AVL_Tree<Key, Value, Compare, Stats, Augment>::aggregate_less(const Key &key) const
+{
+   Summary below = Augment::identity();
+   NodeIndex n = root;
+   while(n != NIL)
+   {
+      if(comp(N(n).key, key))
+      {
+         below = Augment::combine(below, Augment::combine(summaryOf(N(n).left), Augment::lift(N(n).secondValue)));
+         n = N(n).right;
+      }
+      else
+         n = N(n).left;
+   }
+   return below;
+}
+
+//------------------------------------------------------------------
+// at_weight()
+// For a summary that adds up non-negative per-value weights (such as
+//  CountAugment, or a 0/1 weight marking live values), the iterator
+//  at the first key where the running total in key order reaches
+//  weight, or end() if the whole tree weighs less. With 0/1 weights
+//  this is select() over the weight-1 values only. O(log n).
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats, class Augment>
+typename AVL_Tree<Key, Value, Compare, Stats, Augment>::iterator AVL_Tree<Key, Value, Compare, Stats, Augment>::at_weight(Summary weight) const
+{
+   NodeIndex n = root;
+   while(n != NIL)
+   {
+      Summary left = summaryOf(N(n).left);
+      if(weight <= left)
+      {
+         n = N(n).left;
+         continue;
+      }
+      Summary here = Augment::lift(N(n).secondValue);
+      if(weight <= left + here)
+         return iterator(this, n);
+      weight -= left + here;
+      n = N(n).right;
+   }
+   return end();
+}
@@ -0,0 +1,294 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "AVL_Tree.h"
+#include "NodePool.h"
+using namespace std;
+
+//------------------------------------------------------------------
+// BPlusEntry
+// One key and its value as stored in a leaf. Named like AVLTreeNode's
+//  fields so code written against AVL_Tree::Node reads either tree.
+//------------------------------------------------------------------
+template <class Key, class Value>
+struct BPlusEntry
+{
+   Key key;
+   Value secondValue;
+};
+
+//------------------------------------------------------------------
+// Leaves hold up to SLOTS entries in key order and are linked to
+//  their neighbours, so iteration never climbs the tree. left also
+//  serves as NodePool's free-list link once a leaf is released.
+//------------------------------------------------------------------
+template <class Key, class Value, int SLOTS>
+struct BPlusLeaf
+{
+   NodeIndex left;     // previous leaf, or NIL
+   NodeIndex right;    // next leaf, or NIL
+   uint32_t count;
+   BPlusEntry<Key, Value> items[SLOTS];
+};
+
+//------------------------------------------------------------------
+// Inner nodes route by keys[i], the smallest key allowed in child
+//  i + 1, and remember how many entries sit under each child so rank
+//  queries descend like AVL_Tree's size-augmented ones.
+//------------------------------------------------------------------
+template <class Key, int SLOTS>
+struct BPlusInner
+{
+   NodeIndex left;               // NodePool free-list link only
+   uint32_t count;               // children in use
+   Key keys[SLOTS - 1];
+   NodeIndex children[SLOTS];
+   uint32_t sizes[SLOTS];        // entries under children[i]
+};
+
+//------------------------------------------------------------------
+// In-node search
+// Both searches scan a whole node: nodes are a few cache lines, and a
+//  counting scan has no data-dependent branch to mispredict. Arrays
+//  are read up to their capacity rounded to whole vectors, so the
+//  tree keeps unused slots initialized.
+//------------------------------------------------------------------
+template <class Key, class Compare>
+struct BPlusSearch
+{
+   // keys among keys[0, n) that are <= key: the child to descend to
+   static int countNotGreater(const Key *keys, int n, const Key &key, const Compare &comp)
+   {
+      int count = 0;
+      for(int i = 0; i < n; i++)
+         count += !comp(key, keys[i]);
+      return count;
+   }
+
+   // entries among items[0, n) whose key is < key: key's slot
+   template <class Value>
+   static int countLess(const BPlusEntry<Key, Value> *items, int n, const Key &key, const Compare &comp)
+   {
+      int count = 0;
+      for(int i = 0; i < n; i++)
+         count += comp(items[i].key, key);
+      return count;
+   }
+};
+
+#ifdef __SSE2__
+// int keys compare four at a time; each lane's result becomes one bit
+//  of a mask, and the answer is a popcount of the mask's first n bits
+template <>
+struct BPlusSearch<int, less<int> >
+{
+   static uint64_t firstBits(int n)
+   {
+      return n >= 64 ? ~0ull : (1ull << n) - 1;
+   }
+
+   static int countNotGreater(const int *keys, int n, const int &key, const less<int> &)
+   {
+      __m128i k = _mm_set1_epi32(key);
+      uint64_t greater = 0;
+      for(int i = 0; i < n; i += 4)
+      {
+         __m128i v = _mm_loadu_si128((const __m128i *)(keys + i));
+         greater |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k))) << i;
+      }
+      return n - __builtin_popcountll(greater & firstBits(n));
+   }
+
+   template <class Value>
+   static int countLess(const BPlusEntry<int, Value> *items, int n, const int &key, const less<int> &comp)
+   {
+      if constexpr(sizeof(BPlusEntry<int, Value>) != 8)
+      {
+         int count = 0;
+         for(int i = 0; i < n; i++)
+            count += comp(items[i].key, key);
+         return count;
+      }
+      else
+      {
+         // entries are (key, value) pairs of ints; shuffling the even
+         //  lanes of two loads gathers four keys
+         __m128i k = _mm_set1_epi32(key);
+         uint64_t below = 0;
+         for(int i = 0; i < n; i += 4)
+         {
+            __m128 a = _mm_loadu_ps((const float *)(items + i));
+            __m128 b = _mm_loadu_ps((const float *)(items + i + 2));
+            __m128i v = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            below |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v))) << i;
+         }
+         return __builtin_popcountll(below & firstBits(n));
+      }
+   }
+};
+#endif
+
+//------------------------------------------------------------------
+// BPlusTree
+// Ordered index with AVL_Tree's interface, for large trees of small
+//  keys where a binary tree pays a cache miss per level. Nodes hold
+//  many keys (leaves about 256 bytes of entries, inner nodes about 128
+//  bytes of keys), so a lookup touches a handful of nodes, each
+//  searched with SIMD when the key is int. Leaves are linked for
+//  scans, and inner nodes count the entries under each child for
+//  select(), rank_of() and count_less().
+//
+// Keys are unique: Insert() of a key already present replaces its
+//  value. Node pointers and iterators returned by the tree stay valid
+//  only until the next Insert or Delete, which may move entries
+//  between leaves.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare = less<Key>, class Stats = NoStats>
+class BPlusTree
+{
+   public:
+      typedef BPlusEntry<Key, Value> Node;
+
+      // capacities rounded down to whole 4-lane vectors
+      static const int LEAF_SLOTS = max<int>(8, 256 / sizeof(Node)) / 4 * 4;
+      static const int INNER_SLOTS = max<int>(8, 128 / sizeof(Key)) / 4 * 4 + 1;
+      static const int MAX_DEPTH = 32;
+
+      typedef BPlusLeaf<Key, Value, LEAF_SLOTS> Leaf;
+      typedef BPlusInner<Key, INNER_SLOTS> Inner;
+
+      //------------------------------------------------------------------
+      // iterator
+      // Bidirectional in-order iterator over the leaf chain. end() is
+      //  the position after the largest key; decrementing it yields the
+      //  largest key, and decrementing begin() yields end().
+      //------------------------------------------------------------------
+      class iterator
+      {
+         private:
+            const BPlusTree *tree;
+            NodeIndex leaf;
+            int slot;
+         public:
+            typedef bidirectional_iterator_tag iterator_category;
+            typedef Node value_type;
+            typedef ptrdiff_t difference_type;
+            typedef Node* pointer;
+            typedef Node& reference;
+
+            iterator() : tree(nullptr), leaf(NIL), slot(0) {}
+            iterator(const BPlusTree *t, NodeIndex l, int s) : tree(t), leaf(l), slot(s) {}
+            Node& operator*() const { return tree->L(leaf).items[slot]; }
+            Node* operator->() const { return &tree->L(leaf).items[slot]; }
+            iterator& operator++()
+            {
+               if(++slot == (int)tree->L(leaf).count)
+               {
+                  leaf = tree->L(leaf).right;
+                  slot = 0;
+               }
+               return *this;
+            }
+            iterator& operator--()
+            {
+               if(leaf == NIL)
+               {
+                  leaf = tree->tail;
+                  slot = tree->L(leaf).count - 1;
+               }
+               else if(slot == 0)
+               {
+                  leaf = tree->L(leaf).left;   // NIL (end) before the first key
+                  slot = (leaf == NIL) ? 0 : tree->L(leaf).count - 1;
+               }
+               else
+                  slot--;
+               return *this;
+            }
+            iterator operator++(int) { iterator old = *this; ++*this; return old; }
+            iterator operator--(int) { iterator old = *this; --*this; return old; }
+            bool operator==(const iterator &other) const { return leaf == other.leaf && slot == other.slot; }
+            bool operator!=(const iterator &other) const { return !(*this == other); }
+      };
+      typedef std::reverse_iterator<iterator> reverse_iterator;
+
+   private:
+      // one inner node on the way down and the child taken there
+      struct Step
+      {
+         NodeIndex node;
+         int child;
+      };
+
+      NodeIndex root;
+      int height;             // inner levels above the leaves
+      NodeIndex head, tail;   // first and last leaf
+      int count;
+      NodePool<Leaf> leaves;
+      NodePool<Inner> inners;
+      Compare comp;
+      [[no_unique_address]] Stats stats;
+
+      Leaf& L(NodeIndex i) const { return leaves.at(i); }
+      Inner& I(NodeIndex i) const { return inners.at(i); }
+      NodeIndex newLeaf();
+      NodeIndex newInner();
+      int childFor(const Inner &in, const Key &key) const;
+      int slotFor(const Leaf &leaf, const Key &key) const;
+      NodeIndex descend(const Key &key, Step *path) const;
+      NodeIndex findEntry(const Key &key, int &slot) const;
+      void insertChild(Step *path, int depth, const Key &separator, NodeIndex child, uint32_t size);
+      void fixLeaf(Step *path, int depth, NodeIndex leaf);
+      void fixInner(Step *path, int depth);
+      void removeChild(Inner &in, int child);
+   public:
+      BPlusTree();
+      BPlusTree(const BPlusTree&) = delete;
+      BPlusTree& operator=(const BPlusTree&) = delete;
+      Node* Insert(const Key &key, const Value &value);
+      void Delete(const Key &key);
+      Node* search(const Key &key) const;
+      bool update(const Key &key, const Value &value);
+      Node* Predecessor(const Key &key) const;
+      Node* Successor(const Key &key) const;
+      Node* findMax() const;
+
+      // Bulk operations
+      void Clear();
+      template <class Reclaimer>
+      void Clear(Reclaimer &deferred);
+      void build_from_sorted(const vector<pair<Key, Value> > &items);
+      void collect_sorted(vector<pair<Key, Value> > &out) const;
+
+      // In-order iteration
+      iterator begin() const;
+      iterator end() const;
+      reverse_iterator rbegin() const;
+      reverse_iterator rend() const;
+      iterator find(const Key &key) const;
+      iterator lower_bound(const Key &key) const;
+      iterator at_rank(int rank) const;
+
+      // Order statistics
+      int Size() const;
+      Node* select(int rank) const;
+      int rank_of(const Key &key) const;
+      int count_less(const Key &key) const;
+
+      // Instrumentation: searches counts descents and comparisons
+      //  counts nodes searched, since a node is searched in one pass
+      void collect_stats(TreeStats &out) const;
+};
+
+#include "BPlusTree.tpp"
+
+#endif
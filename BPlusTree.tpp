@@ -0,0 +1,750 @@
+//------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+BPlusTree<Key, Value, Compare, Stats>::BPlusTree()
+{
+   root = NIL;
+   height = 0;
+   head = NIL;
+   tail = NIL;
+   count = 0;
+}
+
+//------------------------------------------------------------------
+// newLeaf() / newInner()
+// Nodes come out of the pools with every slot value-initialized, since
+//  the node searches read whole vectors past the slots in use.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+NodeIndex BPlusTree<Key, Value, Compare, Stats>::newLeaf()
+{
+   NodeIndex i = leaves.Allocate();
+   L(i) = Leaf();
+   return i;
+}
+
+template <class Key, class Value, class Compare, class Stats>
+NodeIndex BPlusTree<Key, Value, Compare, Stats>::newInner()
+{
+   NodeIndex i = inners.Allocate();
+   I(i) = Inner();
+   return i;
+}
+
+// childFor
+// child of in whose range holds key
+template <class Key, class Value, class Compare, class Stats>
+int BPlusTree<Key, Value, Compare, Stats>::childFor(const Inner &in, const Key &key) const
+{
+   stats.comparison();
+   return BPlusSearch<Key, Compare>::countNotGreater(in.keys, in.count - 1, key, comp);
+}
+
+// slotFor
+// first slot of leaf whose key is not less than key
+template <class Key, class Value, class Compare, class Stats>
+int BPlusTree<Key, Value, Compare, Stats>::slotFor(const Leaf &leaf, const Key &key) const
+{
+   stats.comparison();
+   return BPlusSearch<Key, Compare>::template countLess<Value>(leaf.items, leaf.count, key, comp);
+}
+
+//------------------------------------------------------------------
+// descend()
+// Walk from the root to the leaf whose range holds key and return it
+//  (NIL for an empty tree). If path is given, path[d] records the
+//  inner node at depth d and the child taken there.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+NodeIndex BPlusTree<Key, Value, Compare, Stats>::descend(const Key &key, Step *path) const
+{
+   stats.search();
+   NodeIndex n = root;
+   for(int depth = 0; depth < height; depth++)
+   {
+      const Inner &in = I(n);
+      int c = childFor(in, key);
+      if(path != nullptr)
+      {
+         path[depth].node = n;
+         path[depth].child = c;
+      }
+      n = in.children[c];
+   }
+   return n;
+}
+
+// findEntry
+// leaf holding key, with its slot, or NIL if key is not in the tree
+template <class Key, class Value, class Compare, class Stats>
+NodeIndex BPlusTree<Key, Value, Compare, Stats>::findEntry(const Key &key, int &slot) const
+{
+   NodeIndex leaf = descend(key, nullptr);
+   if(leaf == NIL)
+      return NIL;
+   const Leaf &l = L(leaf);
+   slot = slotFor(l, key);
+   if(slot < (int)l.count && !comp(key, l.items[slot].key))
+      return leaf;
+   return NIL;
+}
+
+//------------------------------------------------------------------
+// Insert()
+// Put key and value in their leaf, splitting it in half when full and
+//  passing the new right half's first key up as its separator. A key
+//  already present has its value replaced. Returns the entry.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::Insert(const Key &key, const Value &value)
+{
+   if(root == NIL)
+   {
+      root = newLeaf();
+      head = root;
+      tail = root;
+      height = 0;
+   }
+   Step path[MAX_DEPTH];
+   NodeIndex leaf = descend(key, path);
+   Leaf &l = L(leaf);
+   int slot = slotFor(l, key);
+   if(slot < (int)l.count && !comp(key, l.items[slot].key))
+   {
+      l.items[slot].secondValue = value;
+      return &l.items[slot];
+   }
+
+   count++;
+   for(int d = 0; d < height; d++)
+      I(path[d].node).sizes[path[d].child]++;
+   if(l.count < (uint32_t)LEAF_SLOTS)
+   {
+      copy_backward(l.items + slot, l.items + l.count, l.items + l.count + 1);
+      l.items[slot] = Node{key, value};
+      l.count++;
+      return &l.items[slot];
+   }
+
+   // Full: the upper entries move to a new right neighbour so that,
+   //  with the new entry, the left leaf keeps half
+   NodeIndex split = newLeaf();
+   Leaf &r = L(split);
+   int half = (LEAF_SLOTS + 1) / 2;
+   bool goesLeft = slot < half;
+   int from = goesLeft ? half - 1 : half;
+   copy(l.items + from, l.items + LEAF_SLOTS, r.items);
+   r.count = LEAF_SLOTS - from;
+   l.count = from;
+   Leaf &target = goesLeft ? l : r;
+   int at = goesLeft ? slot : slot - half;
+   copy_backward(target.items + at, target.items + target.count, target.items + target.count + 1);
+   target.items[at] = Node{key, value};
+   target.count++;
+
+   r.left = leaf;
+   r.right = l.right;
+   if(l.right != NIL)
+      L(l.right).left = split;
+   else
+      tail = split;
+   l.right = split;
+
+   insertChild(path, height, r.items[0].key, split, r.count);
+   return &target.items[at];
+}
+
+//------------------------------------------------------------------
+// insertChild()
+// child, holding size entries, was split off the right of the node
+//  reached through path[depth - 1]. Link it into that parent just
+//  after its sibling, splitting the parent in turn when it is full;
+//  at depth 0 the tree grows a new root.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::insertChild(Step *path, int depth, const Key &separator,
+                                                        NodeIndex child, uint32_t size)
+{
+   if(depth == 0)
+   {
+      NodeIndex top = newInner();
+      Inner &t = I(top);
+      t.count = 2;
+      t.keys[0] = separator;
+      t.children[0] = root;
+      t.children[1] = child;
+      t.sizes[0] = count - size;
+      t.sizes[1] = size;
+      root = top;
+      height++;
+      return;
+   }
+
+   NodeIndex node = path[depth - 1].node;
+   int c = path[depth - 1].child;
+   Inner &in = I(node);
+   in.sizes[c] -= size;
+   if(in.count < (uint32_t)INNER_SLOTS)
+   {
+      copy_backward(in.keys + c, in.keys + in.count - 1, in.keys + in.count);
+      copy_backward(in.children + c + 1, in.children + in.count, in.children + in.count + 1);
+      copy_backward(in.sizes + c + 1, in.sizes + in.count, in.sizes + in.count + 1);
+      in.keys[c] = separator;
+      in.children[c + 1] = child;
+      in.sizes[c + 1] = size;
+      in.count++;
+      return;
+   }
+
+   // Full: lay the INNER_SLOTS + 1 children out in order, keep the
+   //  first half here and move the rest to a new right sibling. The key
+   //  between the halves moves up to the grandparent.
+   Key keys[INNER_SLOTS];
+   NodeIndex children[INNER_SLOTS + 1];
+   uint32_t sizes[INNER_SLOTS + 1];
+   copy(in.keys, in.keys + c, keys);
+   keys[c] = separator;
+   copy(in.keys + c, in.keys + INNER_SLOTS - 1, keys + c + 1);
+   copy(in.children, in.children + c + 1, children);
+   children[c + 1] = child;
+   copy(in.children + c + 1, in.children + INNER_SLOTS, children + c + 2);
+   copy(in.sizes, in.sizes + c + 1, sizes);
+   sizes[c + 1] = size;
+   copy(in.sizes + c + 1, in.sizes + INNER_SLOTS, sizes + c + 2);
+
+   int half = (INNER_SLOTS + 1) / 2;
+   NodeIndex split = newInner();
+   Inner &r = I(split);
+   in.count = half;
+   copy(keys, keys + half - 1, in.keys);
+   copy(children, children + half, in.children);
+   copy(sizes, sizes + half, in.sizes);
+   r.count = INNER_SLOTS + 1 - half;
+   copy(keys + half, keys + INNER_SLOTS, r.keys);
+   copy(children + half, children + INNER_SLOTS + 1, r.children);
+   copy(sizes + half, sizes + INNER_SLOTS + 1, r.sizes);
+   uint32_t moved = 0;
+   for(uint32_t i = 0; i < r.count; i++)
+      moved += r.sizes[i];
+
+   insertChild(path, depth - 1, keys[half - 1], split, moved);
+}
+
+//------------------------------------------------------------------
+// Delete()
+// Remove key's entry, if any. A leaf left under half full borrows an
+//  entry from a neighbour under the same parent or, when both are at
+//  the minimum, is merged with one; merges can ripple up to the root.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::Delete(const Key &key)
+{
+   Step path[MAX_DEPTH];
+   NodeIndex leaf = descend(key, path);
+   if(leaf == NIL)
+      return;
+   Leaf &l = L(leaf);
+   int slot = slotFor(l, key);
+   if(slot == (int)l.count || comp(key, l.items[slot].key))
+      return;   // key not found
+
+   copy(l.items + slot + 1, l.items + l.count, l.items + slot);
+   l.count--;
+   count--;
+   for(int d = 0; d < height; d++)
+      I(path[d].node).sizes[path[d].child]--;
+
+   if(height == 0)
+   {
+      if(l.count == 0)
+      {
+         leaves.Release(leaf);
+         root = NIL;
+         head = NIL;
+         tail = NIL;
+      }
+      return;
+   }
+   if(l.count < (uint32_t)LEAF_SLOTS / 2)
+      fixLeaf(path, height, leaf);
+}
+
+//------------------------------------------------------------------
+// fixLeaf()
+// leaf, the child taken at path[depth - 1], is under half full.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::fixLeaf(Step *path, int depth, NodeIndex leaf)
+{
+   const uint32_t minimum = LEAF_SLOTS / 2;
+   Inner &p = I(path[depth - 1].node);
+   int c = path[depth - 1].child;
+   Leaf &l = L(leaf);
+
+   // Borrow the largest entry of the left neighbour
+   if(c > 0 && L(p.children[c - 1]).count > minimum)
+   {
+      Leaf &s = L(p.children[c - 1]);
+      copy_backward(l.items, l.items + l.count, l.items + l.count + 1);
+      l.items[0] = s.items[--s.count];
+      l.count++;
+      p.keys[c - 1] = l.items[0].key;
+      p.sizes[c - 1]--;
+      p.sizes[c]++;
+      return;
+   }
+   // ... or the smallest of the right one
+   if(c + 1 < (int)p.count && L(p.children[c + 1]).count > minimum)
+   {
+      Leaf &s = L(p.children[c + 1]);
+      l.items[l.count++] = s.items[0];
+      copy(s.items + 1, s.items + s.count, s.items);
+      s.count--;
+      p.keys[c] = s.items[0].key;
+      p.sizes[c]++;
+      p.sizes[c + 1]--;
+      return;
+   }
+
+   // Both neighbours are at the minimum, so this leaf and one of them
+   //  fit in one: empty the right of the pair into the left
+   int keep = (c > 0) ? c - 1 : c;
+   NodeIndex a = p.children[keep];
+   NodeIndex b = p.children[keep + 1];
+   Leaf &la = L(a);
+   Leaf &lb = L(b);
+   copy(lb.items, lb.items + lb.count, la.items + la.count);
+   la.count += lb.count;
+   la.right = lb.right;
+   if(lb.right != NIL)
+      L(lb.right).left = a;
+   else
+      tail = a;
+   p.sizes[keep] += p.sizes[keep + 1];
+   removeChild(p, keep + 1);
+   leaves.Release(b);
+   fixInner(path, depth - 1);
+}
+
+//------------------------------------------------------------------
+// fixInner()
+// The inner node at path[d] just lost a child. Below half full it
+//  borrows a child from a neighbour through the parent's separator, or
+//  merges with one; a root left with one child is removed.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::fixInner(Step *path, int d)
+{
+   const uint32_t minimum = (INNER_SLOTS + 1) / 2;
+   Inner &n = I(path[d].node);
+   if(d == 0)
+   {
+      if(n.count == 1)
+      {
+         root = n.children[0];
+         inners.Release(path[0].node);
+         height--;
+      }
+      return;
+   }
+   if(n.count >= minimum)
+      return;
+
+   Inner &p = I(path[d - 1].node);
+   int c = path[d - 1].child;
+
+   // Rotate the left neighbour's last child over
+   if(c > 0 && I(p.children[c - 1]).count > minimum)
+   {
+      Inner &s = I(p.children[c - 1]);
+      copy_backward(n.keys, n.keys + n.count - 1, n.keys + n.count);
+      copy_backward(n.children, n.children + n.count, n.children + n.count + 1);
+      copy_backward(n.sizes, n.sizes + n.count, n.sizes + n.count + 1);
+      s.count--;
+      n.keys[0] = p.keys[c - 1];
+      n.children[0] = s.children[s.count];
+      n.sizes[0] = s.sizes[s.count];
+      n.count++;
+      p.keys[c - 1] = s.keys[s.count - 1];
+      p.sizes[c - 1] -= n.sizes[0];
+      p.sizes[c] += n.sizes[0];
+      return;
+   }
+   // ... or the right neighbour's first
+   if(c + 1 < (int)p.count && I(p.children[c + 1]).count > minimum)
+   {
+      Inner &s = I(p.children[c + 1]);
+      uint32_t moved = s.sizes[0];
+      n.keys[n.count - 1] = p.keys[c];
+      n.children[n.count] = s.children[0];
+      n.sizes[n.count] = moved;
+      n.count++;
+      p.keys[c] = s.keys[0];
+      copy(s.keys + 1, s.keys + s.count - 1, s.keys);
+      copy(s.children + 1, s.children + s.count, s.children);
+      copy(s.sizes + 1, s.sizes + s.count, s.sizes);
+      s.count--;
+      p.sizes[c] += moved;
+      p.sizes[c + 1] -= moved;
+      return;
+   }
+
+   // Merge the pair around the parent's separator
+   int keep = (c > 0) ? c - 1 : c;
+   NodeIndex b = p.children[keep + 1];
+   Inner &ia = I(p.children[keep]);
+   Inner &ib = I(b);
+   ia.keys[ia.count - 1] = p.keys[keep];
+   copy(ib.keys, ib.keys + ib.count - 1, ia.keys + ia.count);
+   copy(ib.children, ib.children + ib.count, ia.children + ia.count);
+   copy(ib.sizes, ib.sizes + ib.count, ia.sizes + ia.count);
+   ia.count += ib.count;
+   p.sizes[keep] += p.sizes[keep + 1];
+   removeChild(p, keep + 1);
+   inners.Release(b);
+   fixInner(path, d - 1);
+}
+
+// removeChild
+// drop children[child] (child > 0) and the separator to its left
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::removeChild(Inner &in, int child)
+{
+   copy(in.keys + child, in.keys + in.count - 1, in.keys + child - 1);
+   copy(in.children + child + 1, in.children + in.count, in.children + child);
+   copy(in.sizes + child + 1, in.sizes + in.count, in.sizes + child);
+   in.count--;
+}
+
+// search
+// entry holding key, or nullptr
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::search(const Key &key) const
+{
+   int slot;
+   NodeIndex leaf = findEntry(key, slot);
+   return (leaf == NIL) ? nullptr : &L(leaf).items[slot];
+}
+
+// update
+// replace key's value, as AVL_Tree::update() does; false if key is
+// not in the tree
+template <class Key, class Value, class Compare, class Stats>
+bool BPlusTree<Key, Value, Compare, Stats>::update(const Key &key, const Value &value)
+{
+   Node *entry = search(key);
+   if(entry == nullptr)
+      return false;
+   entry->secondValue = value;
+   return true;
+}
+
+// Predecessor
+// entry holding the largest key less than key, or nullptr if key is
+// not in the tree or is the smallest key
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::Predecessor(const Key &key) const
+{
+   int slot;
+   NodeIndex leaf = findEntry(key, slot);
+   if(leaf == NIL)
+      return nullptr;   // Key not found
+   if(slot > 0)
+      return &L(leaf).items[slot - 1];
+   NodeIndex prev = L(leaf).left;
+   return (prev == NIL) ? nullptr : &L(prev).items[L(prev).count - 1];
+}
+
+// Successor
+// entry holding the smallest key greater than key, or nullptr if key
+// is not in the tree or is the largest key
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::Successor(const Key &key) const
+{
+   int slot;
+   NodeIndex leaf = findEntry(key, slot);
+   if(leaf == NIL)
+      return nullptr;   // Key not found
+   if(slot + 1 < (int)L(leaf).count)
+      return &L(leaf).items[slot + 1];
+   NodeIndex next = L(leaf).right;
+   return (next == NIL) ? nullptr : &L(next).items[0];
+}
+
+// findMax
+// entry holding the largest key, or nullptr for an empty tree
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::findMax() const
+{
+   return (tail == NIL) ? nullptr : &L(tail).items[L(tail).count - 1];
+}
+
+//------------------------------------------------------------------
+// Clear()
+// Drop every entry. Both pools release their slabs at once.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::Clear()
+{
+   leaves.Reset();
+   inners.Reset();
+   root = NIL;
+   height = 0;
+   head = NIL;
+   tail = NIL;
+   count = 0;
+}
+
+//------------------------------------------------------------------
+// Clear(deferred)
+// Like Clear(), but the slabs are handed to deferred to free later.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+template <class Reclaimer>
+void BPlusTree<Key, Value, Compare, Stats>::Clear(Reclaimer &deferred)
+{
+   leaves.Reset(deferred);
+   inners.Reset(deferred);
+   root = NIL;
+   height = 0;
+   head = NIL;
+   tail = NIL;
+   count = 0;
+}
+
+//------------------------------------------------------------------
+// build_from_sorted()
+// Replace the tree's contents with items, which must be in ascending
+//  key order with no repeats. Leaves are filled as evenly as possible
+//  and linked, then each inner level is built over the one below in
+//  O(n) total.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::build_from_sorted(const vector<pair<Key, Value> > &items)
+{
+   Clear();
+   if(items.empty())
+      return;
+
+   // each node of the level just built, its entry count and first key
+   vector<NodeIndex> level;
+   vector<uint32_t> sizes;
+   vector<Key> firsts;
+
+   size_t n = items.size();
+   size_t leafCount = (n + LEAF_SLOTS - 1) / LEAF_SLOTS;
+   size_t next = 0;
+   for(size_t i = 0; i < leafCount; i++)
+   {
+      size_t take = n / leafCount + (i < n % leafCount ? 1 : 0);
+      NodeIndex leaf = newLeaf();
+      Leaf &l = L(leaf);
+      for(size_t j = 0; j < take; j++)
+         l.items[j] = Node{items[next + j].first, items[next + j].second};
+      l.count = take;
+      l.left = tail;
+      if(tail != NIL)
+         L(tail).right = leaf;
+      else
+         head = leaf;
+      tail = leaf;
+      level.push_back(leaf);
+      sizes.push_back(take);
+      firsts.push_back(items[next].first);
+      next += take;
+   }
+   count = n;
+
+   while(level.size() > 1)
+   {
+      vector<NodeIndex> upper;
+      vector<uint32_t> upperSizes;
+      vector<Key> upperFirsts;
+      size_t m = level.size();
+      size_t groups = (m + INNER_SLOTS - 1) / INNER_SLOTS;
+      size_t at = 0;
+      for(size_t g = 0; g < groups; g++)
+      {
+         size_t take = m / groups + (g < m % groups ? 1 : 0);
+         NodeIndex node = newInner();
+         Inner &in = I(node);
+         uint32_t total = 0;
+         for(size_t j = 0; j < take; j++)
+         {
+            in.children[j] = level[at + j];
+            in.sizes[j] = sizes[at + j];
+            if(j > 0)
+               in.keys[j - 1] = firsts[at + j];
+            total += sizes[at + j];
+         }
+         in.count = take;
+         upper.push_back(node);
+         upperSizes.push_back(total);
+         upperFirsts.push_back(firsts[at]);
+         at += take;
+      }
+      level.swap(upper);
+      sizes.swap(upperSizes);
+      firsts.swap(upperFirsts);
+      height++;
+   }
+   root = level[0];
+}
+
+//------------------------------------------------------------------
+// collect_sorted()
+// Append every (key, value) pair to out in ascending key order by
+//  walking the leaf chain.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::collect_sorted(vector<pair<Key, Value> > &out) const
+{
+   out.reserve(out.size() + count);
+   for(NodeIndex leaf = head; leaf != NIL; leaf = L(leaf).right)
+   {
+      const Leaf &l = L(leaf);
+      for(uint32_t i = 0; i < l.count; i++)
+         out.push_back(make_pair(l.items[i].key, l.items[i].secondValue));
+   }
+}
+
+//------------------------------------------------------------------
+// Iteration
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::iterator BPlusTree<Key, Value, Compare, Stats>::begin() const
+{
+   return iterator(this, head, 0);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::iterator BPlusTree<Key, Value, Compare, Stats>::end() const
+{
+   return iterator(this, NIL, 0);
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::reverse_iterator BPlusTree<Key, Value, Compare, Stats>::rbegin() const
+{
+   return reverse_iterator(end());
+}
+
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::reverse_iterator BPlusTree<Key, Value, Compare, Stats>::rend() const
+{
+   return reverse_iterator(begin());
+}
+
+// find
+// iterator at key, or end() if key is not in the tree
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::iterator BPlusTree<Key, Value, Compare, Stats>::find(const Key &key) const
+{
+   int slot;
+   NodeIndex leaf = findEntry(key, slot);
+   return (leaf == NIL) ? end() : iterator(this, leaf, slot);
+}
+
+// lower_bound
+// iterator at the first key not less than key, or end()
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::iterator BPlusTree<Key, Value, Compare, Stats>::lower_bound(const Key &key) const
+{
+   NodeIndex leaf = descend(key, nullptr);
+   if(leaf == NIL)
+      return end();
+   int slot = slotFor(L(leaf), key);
+   if(slot == (int)L(leaf).count)
+      return iterator(this, L(leaf).right, 0);
+   return iterator(this, leaf, slot);
+}
+
+// at_rank
+// iterator at the rank-th smallest key (1-based), or end(). Each
+// level skips the children whose counts add up to less than rank.
+template <class Key, class Value, class Compare, class Stats>
+typename BPlusTree<Key, Value, Compare, Stats>::iterator BPlusTree<Key, Value, Compare, Stats>::at_rank(int rank) const
+{
+   if(rank < 1 || rank > count)
+      return end();
+   NodeIndex n = root;
+   for(int depth = 0; depth < height; depth++)
+   {
+      const Inner &in = I(n);
+      int c = 0;
+      while((uint32_t)rank > in.sizes[c])
+      {
+         rank -= in.sizes[c];
+         c++;
+      }
+      n = in.children[c];
+   }
+   return iterator(this, n, rank - 1);
+}
+
+//------------------------------------------------------------------
+// Order statistics
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+int BPlusTree<Key, Value, Compare, Stats>::Size() const
+{
+   return count;
+}
+
+// select
+// entry holding the rank-th smallest key (1-based), or nullptr
+template <class Key, class Value, class Compare, class Stats>
+BPlusEntry<Key, Value>* BPlusTree<Key, Value, Compare, Stats>::select(int rank) const
+{
+   iterator it = at_rank(rank);
+   return (it == end()) ? nullptr : &*it;
+}
+
+// count_less
+// number of keys strictly less than key, whether or not key is in
+// the tree: the counts of the children passed over on the way down
+// plus the slot key would take in its leaf
+template <class Key, class Value, class Compare, class Stats>
+int BPlusTree<Key, Value, Compare, Stats>::count_less(const Key &key) const
+{
+   if(root == NIL)
+      return 0;
+   stats.search();
+   int smaller = 0;
+   NodeIndex n = root;
+   for(int depth = 0; depth < height; depth++)
+   {
+      const Inner &in = I(n);
+      int c = childFor(in, key);
+      for(int i = 0; i < c; i++)
+         smaller += in.sizes[i];
+      n = in.children[c];
+   }
+   return smaller + slotFor(L(n), key);
+}
+
+// rank_of
+// 1-based rank of key among all keys in ascending order, or -1 if key
+// is not in the tree
+template <class Key, class Value, class Compare, class Stats>
+int BPlusTree<Key, Value, Compare, Stats>::rank_of(const Key &key) const
+{
+   int slot;
+   if(findEntry(key, slot) == NIL)
+      return -1;
+   return count_less(key) + 1;
+}
+
+//------------------------------------------------------------------
+// collect_stats()
+// Add this tree's counters, entry count and height (leaf level
+//  included) to out.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare, class Stats>
+void BPlusTree<Key, Value, Compare, Stats>::collect_stats(TreeStats &out) const
+{
+   stats.addTo(out);
+   out.nodes += count;
+   out.height = max(out.height, (root == NIL) ? 0 : height + 1);
+}
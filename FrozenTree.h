@@ -0,0 +1,43 @@
+#ifndef FROZEN_TREE_H
+#define FROZEN_TREE_H
+
+#include <functional>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//------------------------------------------------------------------
+// FrozenTree
+// An immutable copy of a sorted key set for read-only bursts, made by
+//  AVL_Tree::freeze(). Keys sit in one array in Eytzinger (BFS) order:
+//  slot 1 is the root and slot k has children 2k and 2k+1, so the
+//  first levels of every search share a few cache lines and the next
+//  levels can be prefetched before they are needed. The descent has no
+//  data-dependent branch: each level is one comparison whose result
+//  becomes the low bit of the next slot.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare = less<Key> >
+class FrozenTree
+{
+   private:
+      vector<Key> keys;          // Eytzinger order, slot 0 unused
+      vector<Value> values;      // values[k] belongs to keys[k]
+      vector<uint32_t> order;    // order[k] = number of keys before keys[k]
+      uint32_t count;
+      Compare comp;
+
+      size_t fill(const vector<pair<Key, Value> > &items, size_t next, size_t k);
+      size_t lowerSlot(const Key &key) const;
+   public:
+      FrozenTree();
+      void build(const vector<pair<Key, Value> > &items);
+      int Size() const;
+      const Value* search(const Key &key) const;
+      int rank_of(const Key &key) const;
+      int count_less(const Key &key) const;
+};
+
+#include "FrozenTree.tpp"
+
+#endif
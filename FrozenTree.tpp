@@ -0,0 +1,93 @@
+//------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+FrozenTree<Key, Value, Compare>::FrozenTree()
+{
+   count = 0;
+}
+
+// place items[next...] into the subtree at slot k in order; returns
+//  the next unplaced item
+template <class Key, class Value, class Compare>
+size_t FrozenTree<Key, Value, Compare>::fill(const vector<pair<Key, Value> > &items, size_t next, size_t k)
+{
+   if(k > count)
+      return next;
+   next = fill(items, next, 2 * k);
+   keys[k] = items[next].first;
+   values[k] = items[next].second;
+   order[k] = next;
+   next++;
+   return fill(items, next, 2 * k + 1);
+}
+
+//------------------------------------------------------------------
+// build()
+// Replace the contents with items, which must be sorted by key.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void FrozenTree<Key, Value, Compare>::build(const vector<pair<Key, Value> > &items)
+{
+   count = items.size();
+   keys.assign(count + 1, Key());
+   values.assign(count + 1, Value());
+   order.assign(count + 1, 0);
+   fill(items, 0, 1);
+}
+
+template <class Key, class Value, class Compare>
+int FrozenTree<Key, Value, Compare>::Size() const
+{
+   return count;
+}
+
+//------------------------------------------------------------------
+// lowerSlot()
+// Slot of the first key not less than key, or 0 if every key is less.
+//  The walk goes right whenever keys[k] < key, so the final slot's
+//  bits record the path; stripping the trailing right turns and the
+//  last left turn leaves the last node where the walk went left.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+size_t FrozenTree<Key, Value, Compare>::lowerSlot(const Key &key) const
+{
+   // the 16 slots four levels below k start at 16k; prefetching them
+   //  overlaps the next memory fetch with this level's comparisons
+   const uintptr_t base = (uintptr_t)keys.data();
+   size_t k = 1;
+   while(k <= count)
+   {
+      __builtin_prefetch((const void*)(base + 16 * k * sizeof(Key)));
+      k = 2 * k + (size_t)comp(keys[k], key);
+   }
+   return k >> __builtin_ffsll(~(long long)k);
+}
+
+// value stored under key, or nullptr
+template <class Key, class Value, class Compare>
+const Value* FrozenTree<Key, Value, Compare>::search(const Key &key) const
+{
+   size_t k = lowerSlot(key);
+   if(k == 0 || comp(key, keys[k]))
+      return nullptr;
+   return &values[k];
+}
+
+// 1-based position of key in sorted order, or -1 if absent
+template <class Key, class Value, class Compare>
+int FrozenTree<Key, Value, Compare>::rank_of(const Key &key) const
+{
+   size_t k = lowerSlot(key);
+   if(k == 0 || comp(key, keys[k]))
+      return -1;
+   return order[k] + 1;
+}
+
+// number of keys less than key
+template <class Key, class Value, class Compare>
+int FrozenTree<Key, Value, Compare>::count_less(const Key &key) const
+{
+   size_t k = lowerSlot(key);
+   return (k == 0) ? count : order[k];
+}
@@ -0,0 +1,57 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stdint.h>
+using namespace std;
+
+// Nodes refer to each other by 32-bit index into their pool instead of
+//  by pointer. Index 0 is never handed out and plays the role of NULL.
+typedef uint32_t NodeIndex;
+const NodeIndex NIL = 0;
+
+//------------------------------------------------------------------
+// NodePool
+// Slab allocator for tree nodes. Slab s holds FIRST_SLAB << s nodes,
+//  so an index maps to its slab with one count-leading-zeros and
+//  nodes never move once handed out. Released nodes are recycled
+//  through a free list threaded through their left index, and every
+//  slab is freed at once when the pool dies.
+//------------------------------------------------------------------
+template <class Node>
+class NodePool
+{
+   private:
+      static const int FIRST_SHIFT = 4;               // first slab holds 16
+      static const NodeIndex FIRST_SLAB = 1u << FIRST_SHIFT;
+      static const int MAX_SLABS = 32 - FIRST_SHIFT;  // enough for 2^32 nodes
+      Node *slabs[MAX_SLABS];     // slab table, NULL past slabCount
+      int slabCount;
+      NodeIndex nextIndex;        // next never-used index
+      NodeIndex freeList;         // recycled nodes, linked by left
+   public:
+      NodePool();
+      ~NodePool();
+      NodePool(const NodePool&) = delete;
+      NodePool& operator=(const NodePool&) = delete;
+      NodeIndex Allocate();
+      void Release(NodeIndex i);
+      void Reset();
+      template <class Reclaimer>
+      void Reset(Reclaimer &deferred);
+
+      //------------------------------------------------------------------
+      // at()
+      // Resolve an index to its node. Index i lives at position
+      //  j = i + FIRST_SLAB - 1, whose highest set bit picks the slab.
+      //------------------------------------------------------------------
+      Node& at(NodeIndex i) const
+      {
+         uint32_t j = i + FIRST_SLAB - 1;
+         int high = 31 - __builtin_clz(j);
+         return slabs[high - FIRST_SHIFT][j - (1u << high)];
+      }
+};
+
+#include "NodePool.tpp"
+
+#endif
@@ -0,0 +1,85 @@
+//------------------------------------------------------------------
+// Default constructor
+// No slab is allocated until the first node is requested.
+//------------------------------------------------------------------
+template <class Node>
+NodePool<Node>::NodePool()
+{
+   slabCount = 0;
+   nextIndex = 1;   // index 0 is NIL
+   freeList = NIL;
+}
+
+//------------------------------------------------------------------
+// Class destructor
+// Release every slab in one pass; nodes are never freed one by one.
+//------------------------------------------------------------------
+template <class Node>
+NodePool<Node>::~NodePool()
+{
+   for(int s = 0; s < slabCount; s++)
+      delete [] slabs[s];
+}
+
+//------------------------------------------------------------------
+// Allocate()
+// Hand out a recycled node if there is one, otherwise the next unused
+//  index, adding a slab twice the size of the last one when the
+//  current slabs are full. The node's contents are unspecified.
+//------------------------------------------------------------------
+template <class Node>
+NodeIndex NodePool<Node>::Allocate()
+{
+   if(freeList != NIL)
+   {
+      NodeIndex i = freeList;
+      freeList = at(i).left;
+      return i;
+   }
+   uint32_t j = nextIndex + FIRST_SLAB - 1;
+   int slab = 31 - __builtin_clz(j) - FIRST_SHIFT;
+   if(slab == slabCount)
+      slabs[slabCount++] = new Node[FIRST_SLAB << slab];
+   return nextIndex++;
+}
+
+//------------------------------------------------------------------
+// Release()
+// Push a node that came from this pool onto the free list.
+//------------------------------------------------------------------
+template <class Node>
+void NodePool<Node>::Release(NodeIndex i)
+{
+   at(i).left = freeList;
+   freeList = i;
+}
+
+//------------------------------------------------------------------
+// Reset()
+// Free every slab at once and start over with an empty pool.
+//------------------------------------------------------------------
+template <class Node>
+void NodePool<Node>::Reset()
+{
+   for(int s = 0; s < slabCount; s++)
+      delete [] slabs[s];
+   slabCount = 0;
+   nextIndex = 1;
+   freeList = NIL;
+}
+
+//------------------------------------------------------------------
+// Reset(deferred)
+// Like Reset(), but the slabs are handed to deferred.retire_array()
+//  to be freed later, so this costs one hand-off per slab.
+//------------------------------------------------------------------
+template <class Node>
+template <class Reclaimer>
+void NodePool<Node>::Reset(Reclaimer &deferred)
+{
+   for(int s = 0; s < slabCount; s++)
+      deferred.retire_array(slabs[s]);
+   slabCount = 0;
+   nextIndex = 1;
+   freeList = NIL;
+}
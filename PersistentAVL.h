@@ -0,0 +1,90 @@
+#ifndef PERSISTENT_AVL_H
+#define PERSISTENT_AVL_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+using namespace std;
+
+//------------------------------------------------------------------
+// PersistentAVLNode
+// An immutable node. Updates never modify a node; they copy the path
+//  from the root down to the change and share every other subtree.
+//------------------------------------------------------------------
+template <class Key, class Value>
+struct PersistentAVLNode
+{
+   typedef shared_ptr<const PersistentAVLNode> Ptr;
+
+   Key key;
+   Value secondValue;
+   Ptr left;
+   Ptr right;
+   int height;
+   uint32_t size;   // Number of nodes in the subtree rooted here
+};
+
+//------------------------------------------------------------------
+// PersistentAVL
+// A path-copying AVL tree. Insert and Delete build a new version and
+//  publish its root with one atomic store, so readers never lock: they
+//  take a Snapshot, which pins one immutable version for as long as
+//  they hold it. A version's nodes are reclaimed by reference count
+//  once no snapshot or newer version still points at them.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare = less<Key> >
+class PersistentAVL
+{
+   public:
+      typedef PersistentAVLNode<Key, Value> Node;
+      typedef typename Node::Ptr NodePtr;
+
+      // A read-only handle on one version of the tree
+      class Snapshot
+      {
+         private:
+            NodePtr root;
+            Compare comp;
+         public:
+            Snapshot() {}
+            explicit Snapshot(NodePtr r) : root(r) {}
+            const Node* search(const Key &key) const;
+            const Node* select(int rank) const;
+            int rank_of(const Key &key) const;
+            int Size() const;
+      };
+
+   private:
+      atomic<NodePtr> root;   // Latest published version
+      mutex writeLock;        // Serializes writers; readers never take it
+      Compare comp;
+
+      static int height(const NodePtr &n);
+      static uint32_t size(const NodePtr &n);
+      static NodePtr make(const Node &from, NodePtr left, NodePtr right);
+      static NodePtr rotateLeft(const NodePtr &n);
+      static NodePtr rotateRight(const NodePtr &n);
+      static NodePtr balance(const NodePtr &n);
+      NodePtr insert(const NodePtr &n, const Key &key, const Value &value);
+      NodePtr erase(const NodePtr &n, const Key &key, bool &found);
+      static NodePtr eraseMin(const NodePtr &n, NodePtr &min);
+      static NodePtr buildRange(const vector<pair<Key, Value> > &items, size_t lo, size_t hi);
+   public:
+      PersistentAVL();
+      PersistentAVL(const PersistentAVL&) = delete;
+      PersistentAVL& operator=(const PersistentAVL&) = delete;
+      void Insert(const Key &key, const Value &value);
+      bool Delete(const Key &key);
+      void Clear();
+      void Batch(const vector<Key> &removed, const vector<pair<Key, Value> > &added);
+      void build_from_sorted(const vector<pair<Key, Value> > &items);
+      Snapshot snapshot() const;
+};
+
+#include "PersistentAVL.tpp"
+
+#endif
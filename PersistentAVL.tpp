@@ -0,0 +1,311 @@
+//------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+PersistentAVL<Key, Value, Compare>::PersistentAVL()
+{
+   root.store(NodePtr());
+}
+
+// height of a subtree (0 when empty)
+template <class Key, class Value, class Compare>
+int PersistentAVL<Key, Value, Compare>::height(const NodePtr &n)
+{
+   return n ? n->height : 0;
+}
+
+// node count of a subtree (0 when empty)
+template <class Key, class Value, class Compare>
+uint32_t PersistentAVL<Key, Value, Compare>::size(const NodePtr &n)
+{
+   return n ? n->size : 0;
+}
+
+//------------------------------------------------------------------
+// make()
+// Copy from's key and value into a new node with the given children,
+//  deriving height and size from them.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::make(const Node &from, NodePtr left, NodePtr right)
+{
+   shared_ptr<Node> n = make_shared<Node>();
+   n->key = from.key;
+   n->secondValue = from.secondValue;
+   n->height = 1 + max(height(left), height(right));
+   n->size = 1 + size(left) + size(right);
+   n->left = left;
+   n->right = right;
+   return n;
+}
+
+//------------------------------------------------------------------
+// rotateLeft() / rotateRight()
+// Single rotations that return a new subtree root; the rotated nodes
+//  are copied, their untouched children shared.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::rotateLeft(const NodePtr &n)
+{
+   const NodePtr &r = n->right;
+   return make(*r, make(*n, n->left, r->left), r->right);
+}
+
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::rotateRight(const NodePtr &n)
+{
+   const NodePtr &l = n->left;
+   return make(*l, l->left, make(*n, l->right, n->right));
+}
+
+//------------------------------------------------------------------
+// balance()
+// Restore the AVL property at a freshly copied node whose children
+//  differ in height by at most two.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::balance(const NodePtr &n)
+{
+   int diff = height(n->left) - height(n->right);
+   if(diff > 1)   // left heavy
+   {
+      if(height(n->left->left) < height(n->left->right))
+         return rotateRight(make(*n, rotateLeft(n->left), n->right));
+      return rotateRight(n);
+   }
+   if(diff < -1)  // right heavy
+   {
+      if(height(n->right->right) < height(n->right->left))
+         return rotateLeft(make(*n, n->left, rotateRight(n->right)));
+      return rotateLeft(n);
+   }
+   return n;
+}
+
+// copy the search path for key and hang a new node at its end
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::insert(const NodePtr &n, const Key &key, const Value &value)
+{
+   if(!n)
+   {
+      Node leaf;
+      leaf.key = key;
+      leaf.secondValue = value;
+      return make(leaf, NodePtr(), NodePtr());
+   }
+   if(comp(key, n->key))
+      return balance(make(*n, insert(n->left, key, value), n->right));
+   return balance(make(*n, n->left, insert(n->right, key, value)));
+}
+
+// detach the smallest node of n; returns what is left
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::eraseMin(const NodePtr &n, NodePtr &min)
+{
+   if(!n->left)
+   {
+      min = n;
+      return n->right;
+   }
+   return balance(make(*n, eraseMin(n->left, min), n->right));
+}
+
+// copy the search path for key, leaving the node holding it out
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::erase(const NodePtr &n, const Key &key, bool &found)
+{
+   if(!n)
+      return n;
+   if(comp(key, n->key))
+   {
+      NodePtr left = erase(n->left, key, found);
+      return found ? balance(make(*n, left, n->right)) : n;
+   }
+   if(comp(n->key, key))
+   {
+      NodePtr right = erase(n->right, key, found);
+      return found ? balance(make(*n, n->left, right)) : n;
+   }
+   found = true;
+   if(!n->right)
+      return n->left;
+   NodePtr min;
+   NodePtr right = eraseMin(n->right, min);
+   return balance(make(*min, n->left, right));
+}
+
+//------------------------------------------------------------------
+// Insert()
+// Build a new version holding key and publish it. Equal keys go to
+//  the right, as in AVL_Tree.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void PersistentAVL<Key, Value, Compare>::Insert(const Key &key, const Value &value)
+{
+   lock_guard<mutex> guard(writeLock);
+   root.store(insert(root.load(), key, value));
+}
+
+//------------------------------------------------------------------
+// Delete()
+// Build a new version without key and publish it. Nothing is
+//  published when key is absent.
+// @return true if key was found
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+bool PersistentAVL<Key, Value, Compare>::Delete(const Key &key)
+{
+   lock_guard<mutex> guard(writeLock);
+   bool found = false;
+   NodePtr next = erase(root.load(), key, found);
+   if(found)
+      root.store(next);
+   return found;
+}
+
+//------------------------------------------------------------------
+// Batch()
+// Delete every key in removed, then insert every item in added, and
+//  publish the result as one version: readers see all of the batch
+//  or none of it. Each change still path-copies, O(log n) apiece.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void PersistentAVL<Key, Value, Compare>::Batch(const vector<Key> &removed, const vector<pair<Key, Value> > &added)
+{
+   lock_guard<mutex> guard(writeLock);
+   NodePtr next = root.load();
+   for(size_t i = 0; i < removed.size(); i++)
+   {
+      bool found = false;
+      NodePtr without = erase(next, removed[i], found);
+      if(found)
+         next = without;
+   }
+   for(size_t i = 0; i < added.size(); i++)
+      next = insert(next, added[i].first, added[i].second);
+   root.store(next);
+}
+
+// publish an empty version
+template <class Key, class Value, class Compare>
+void PersistentAVL<Key, Value, Compare>::Clear()
+{
+   lock_guard<mutex> guard(writeLock);
+   root.store(NodePtr());
+}
+
+// balanced subtree over items[lo, hi), middle item at the root
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::NodePtr
+PersistentAVL<Key, Value, Compare>::buildRange(const vector<pair<Key, Value> > &items, size_t lo, size_t hi)
+{
+   if(lo >= hi)
+      return NodePtr();
+   size_t mid = lo + (hi - lo) / 2;
+   Node from;
+   from.key = items[mid].first;
+   from.secondValue = items[mid].second;
+   return make(from, buildRange(items, lo, mid), buildRange(items, mid + 1, hi));
+}
+
+//------------------------------------------------------------------
+// build_from_sorted()
+// Replace the contents with items, which must be sorted by key. The
+//  new version is built in O(n) without touching the published one
+//  and then published with a single store, so readers see either the
+//  old contents or all of the new.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+void PersistentAVL<Key, Value, Compare>::build_from_sorted(const vector<pair<Key, Value> > &items)
+{
+   NodePtr built = buildRange(items, 0, items.size());
+   lock_guard<mutex> guard(writeLock);
+   root.store(built);
+}
+
+//------------------------------------------------------------------
+// snapshot()
+// Pin the latest published version. Safe to call from any thread
+//  while a writer is running.
+//------------------------------------------------------------------
+template <class Key, class Value, class Compare>
+typename PersistentAVL<Key, Value, Compare>::Snapshot PersistentAVL<Key, Value, Compare>::snapshot() const
+{
+   return Snapshot(root.load());
+}
+
+// search
+template <class Key, class Value, class Compare>
+const PersistentAVLNode<Key, Value>* PersistentAVL<Key, Value, Compare>::Snapshot::search(const Key &key) const
+{
+   const Node *current = root.get();
+   while(current != nullptr)
+   {
+      if(comp(key, current->key))
+         current = current->left.get();
+      else if(comp(current->key, key))
+         current = current->right.get();
+      else
+         return current;
+   }
+   return nullptr;
+}
+
+// node holding the rank-th smallest key (1-based), or nullptr
+template <class Key, class Value, class Compare>
+const PersistentAVLNode<Key, Value>* PersistentAVL<Key, Value, Compare>::Snapshot::select(int rank) const
+{
+   if(rank < 1 || rank > Size())
+      return nullptr;
+   uint32_t remaining = rank;
+   const Node *current = root.get();
+   while(current != nullptr)
+   {
+      uint32_t leftSize = size(current->left);
+      if(remaining <= leftSize)
+         current = current->left.get();
+      else if(remaining == leftSize + 1)
+         return current;
+      else
+      {
+         remaining -= leftSize + 1;
+         current = current->right.get();
+      }
+   }
+   return nullptr;
+}
+
+// 1-based rank of key in ascending order, or -1 if absent
+template <class Key, class Value, class Compare>
+int PersistentAVL<Key, Value, Compare>::Snapshot::rank_of(const Key &key) const
+{
+   const Node *current = root.get();
+   int smaller = 0;
+   while(current != nullptr)
+   {
+      if(comp(key, current->key))
+         current = current->left.get();
+      else if(comp(current->key, key))
+      {
+         smaller += size(current->left) + 1;
+         current = current->right.get();
+      }
+      else
+         return smaller + size(current->left) + 1;
+   }
+   return -1;
+}
+
+// number of keys in this version
+template <class Key, class Value, class Compare>
+int PersistentAVL<Key, Value, Compare>::Snapshot::Size() const
+{
+   return size(root);
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "AVL_Tree.h"
+#include "BPlusTree.h"
+#include "event_log.h"
+#include "roster_metrics.h"
+using namespace std;
+
+//------------------------------------------------------------------
+// Benchmark driver
+//
+//   bench [max_n] [--csv]
+//
+// Times AVL_Tree, BPlusTree and roster_metrics operations for
+// n = 10^3 .. max_n (default 10^7) over sequential, random and skewed
+// key/point distributions. Each result is one line of JSON (or CSV
+// with --csv):
+//
+//   bench, op, dist, n, ops, seconds, ops_per_sec, p50_ns, p99_ns,
+//   peak_rss_kb
+//
+// Latencies are per call; ops timed only as a whole (bulk loads)
+// report them as null. peak_rss_kb is the process high-water mark
+// so far, so it only grows across lines.
+//------------------------------------------------------------------
+
+typedef chrono::steady_clock Clock;
+
+static bool csv = false;
+static const char* LOG_PATH = "bench.wal";
+static const char* RECORDS_PATH = "bench.records";
+
+// results of lookups land here so the calls are not optimized away
+static volatile uintptr_t sink;
+
+static long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// percentile of latencies (reorders them)
+static long long percentile(vector<uint32_t>& latencies, double p) {
+    if (latencies.empty()) {
+        return -1;
+    }
+    size_t k = min(latencies.size() - 1, (size_t)(p * latencies.size()));
+    nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+    return latencies[k];
+}
+
+static void report(const char* bench, const char* op, const char* dist, size_t n,
+                   size_t ops, double seconds, vector<uint32_t>& latencies) {
+    long long p50 = percentile(latencies, 0.50);
+    long long p99 = percentile(latencies, 0.99);
+    double rate = seconds > 0 ? ops / seconds : 0;
+    if (csv) {
+        printf("%s,%s,%s,%zu,%zu,%.6f,%.0f,", bench, op, dist, n, ops, seconds, rate);
+        if (p50 >= 0) {
+            printf("%lld,%lld,", p50, p99);
+        } else {
+            printf(",,");
+        }
+        printf("%ld\n", peakRssKb());
+    } else {
+        printf("{\"bench\":\"%s\",\"op\":\"%s\",\"dist\":\"%s\",\"n\":%zu,\"ops\":%zu,"
+               "\"seconds\":%.6f,\"ops_per_sec\":%.0f,",
+               bench, op, dist, n, ops, seconds, rate);
+        if (p50 >= 0) {
+            printf("\"p50_ns\":%lld,\"p99_ns\":%lld,", p50, p99);
+        } else {
+            printf("\"p50_ns\":null,\"p99_ns\":null,");
+        }
+        printf("\"peak_rss_kb\":%ld}\n", peakRssKb());
+    }
+    fflush(stdout);
+}
+
+// time op(i) for i in [0, count) one call at a time
+template <class Op>
+static void timeEach(const char* bench, const char* name, const char* dist, size_t n,
+                     size_t count, Op op) {
+    vector<uint32_t> latencies(count);
+    Clock::time_point start = Clock::now();
+    Clock::time_point last = start;
+    for (size_t i = 0; i < count; ++i) {
+        op(i);
+        Clock::time_point now = Clock::now();
+        latencies[i] = (uint32_t)min<long long>(chrono::duration_cast<chrono::nanoseconds>(now - last).count(),
+                                                 UINT32_MAX);
+        last = now;
+    }
+    double seconds = chrono::duration<double>(last - start).count();
+    report(bench, name, dist, n, count, seconds, latencies);
+}
+
+// n keys in the order they are inserted
+//   sequential: 0, 1, 2, ...
+//   random:     a shuffled permutation of 0 .. n-1
+//   skewed:     n draws from n/100 values, so ~100 copies of each
+static vector<int> makeKeys(const string& dist, size_t n, mt19937_64& rng) {
+    vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (int)i;
+    }
+    if (dist == "random") {
+        shuffle(keys.begin(), keys.end(), rng);
+    } else if (dist == "skewed") {
+        size_t distinct = max<size_t>(1, n / 100);
+        for (size_t i = 0; i < n; ++i) {
+            keys[i] = (int)(rng() % distinct);
+        }
+    }
+    return keys;
+}
+
+static void benchTree(const string& dist, size_t n, mt19937_64& rng) {
+    const char* d = dist.c_str();
+    vector<int> keys = makeKeys(dist, n, rng);
+    vector<int> probes(keys);
+    shuffle(probes.begin(), probes.end(), rng);
+
+    AVL_Tree<int, int> tree;
+    timeEach("avl", "insert", d, n, n, [&](size_t i) { tree.Insert(keys[i], (int)i); });
+    timeEach("avl", "search", d, n, n, [&](size_t i) { sink = (uintptr_t)tree.search(probes[i]); });
+    FrozenTree<int, int> frozen = tree.freeze();
+    timeEach("frozen", "search", d, n, n, [&](size_t i) { sink = (uintptr_t)frozen.search(probes[i]); });
+    timeEach("avl", "predecessor", d, n, n, [&](size_t i) { sink = (uintptr_t)tree.Predecessor(probes[i]); });
+    timeEach("avl", "successor", d, n, n, [&](size_t i) { sink = (uintptr_t)tree.Successor(probes[i]); });
+    timeEach("avl", "select", d, n, n,
+             [&](size_t i) { sink = (uintptr_t)tree.select(probes[i] % tree.Size() + 1); });
+    timeEach("avl", "delete", d, n, n, [&](size_t i) { tree.Delete(probes[i]); });
+
+    // the same operations on the B+-tree (skewed keys repeat, and a
+    // repeated key replaces its value here instead of adding a node)
+    BPlusTree<int, int> fat;
+    timeEach("bplus", "insert", d, n, n, [&](size_t i) { fat.Insert(keys[i], (int)i); });
+    timeEach("bplus", "search", d, n, n, [&](size_t i) { sink = (uintptr_t)fat.search(probes[i]); });
+    timeEach("bplus", "predecessor", d, n, n, [&](size_t i) { sink = (uintptr_t)fat.Predecessor(probes[i]); });
+    timeEach("bplus", "successor", d, n, n, [&](size_t i) { sink = (uintptr_t)fat.Successor(probes[i]); });
+    timeEach("bplus", "select", d, n, n,
+             [&](size_t i) { sink = (uintptr_t)fat.select(probes[i] % fat.Size() + 1); });
+    timeEach("bplus", "delete", d, n, n, [&](size_t i) { fat.Delete(probes[i]); });
+}
+
+// n records over n/50 games of 50 jerseys. dist picks the order the
+// records arrive in and their points:
+//   sequential: games in order, points rising
+//   random:     shuffled arrival, points uniform in 0 .. 10^6
+//   skewed:     shuffled arrival, points in 0 .. 49 (many ties)
+static void benchRoster(const string& dist, size_t n, mt19937_64& rng) {
+    const char* d = dist.c_str();
+    vector<Record> records(n);
+    for (size_t i = 0; i < n; ++i) {
+        records[i].game = (int)(i / 50);
+        records[i].player = (int)(i % 50) + 1;
+        if (dist == "sequential") {
+            records[i].points = (int)i;
+        } else if (dist == "random") {
+            records[i].points = (int)(rng() % 1000001);
+        } else {
+            records[i].points = (int)(rng() % 50);
+        }
+    }
+    if (dist != "sequential") {
+        shuffle(records.begin(), records.end(), rng);
+    }
+    size_t queries = min<size_t>(n, 1000000);
+    vector<int> ranks(queries);
+    for (size_t i = 0; i < queries; ++i) {
+        ranks[i] = (int)(rng() % n) + 1;
+    }
+
+    {
+        roster_metrics roster;
+        timeEach("roster", "record", d, n, n, [&](size_t i) {
+            roster.record(records[i].game, records[i].player, records[i].points);
+        });
+        timeEach("roster", "ranked_receiver", d, n, queries,
+                 [&](size_t i) { sink = roster.ranked_receiver(ranks[i]); });
+        // the ranks leaderboards actually ask for
+        timeEach("roster", "ranked_receiver_top25", d, n, queries,
+                 [&](size_t i) { sink = roster.ranked_receiver(ranks[i] % 25 + 1); });
+        // a leaderboard refresh: ranks 1..100 in one call
+        int top[100], players[100];
+        for (int r = 0; r < 100; ++r) {
+            top[r] = r + 1;
+        }
+        timeEach("roster", "ranked_receivers_top100", d, n, queries / 100,
+                 [&](size_t) { roster.ranked_receivers(top, players); sink = players[99]; });
+        // the same questions about one game of 50
+        int games = (int)(n / 50);
+        timeEach("roster", "ranked_receiver_in_game", d, n, queries,
+                 [&](size_t i) { sink = roster.ranked_receiver_in_game(ranks[i] % games, ranks[i] % 50 + 1); });
+        timeEach("roster", "top_k_in_game_5", d, n, queries,
+                 [&](size_t i) { sink = roster.top_k_in_game(ranks[i] % games, 5).size(); });
+        timeEach("roster", "clear", d, n, n,
+                 [&](size_t i) { roster.clear(records[i].game, records[i].player); });
+    }
+
+    // the same clears leaving tombstones, then ranks read past them
+    {
+        roster_metrics roster;
+        roster.set_lazy_clear(true);
+        roster.record_batch(records);
+        timeEach("roster", "clear_lazy", d, n, n / 2,
+                 [&](size_t i) { roster.clear(records[i].game, records[i].player); });
+        timeEach("roster", "ranked_receiver_lazy", d, n, queries,
+                 [&](size_t i) { sink = roster.ranked_receiver(ranks[i] / 2 + 1); });
+    }
+
+    {
+        roster_metrics roster;
+        vector<uint32_t> none;
+        Clock::time_point start = Clock::now();
+        roster.record_batch(records);
+        report("roster", "record_batch", d, n, n,
+               chrono::duration<double>(Clock::now() - start).count(), none);
+    }
+
+    // write-ahead log: append (group commit every 4096 events), then
+    // replay the whole log into an empty roster
+    remove(LOG_PATH);
+    {
+        event_log log;
+        if (!log.open(LOG_PATH)) {
+            fprintf(stderr, "bench: cannot open %s\n", LOG_PATH);
+            return;
+        }
+        timeEach("event_log", "append", d, n, n, [&](size_t i) {
+            Event e = {EVENT_RECORD, records[i].game, records[i].player, records[i].points};
+            log.append(e);
+        });
+        log.close();
+    }
+    {
+        roster_metrics roster;
+        vector<uint32_t> none;
+        Clock::time_point start = Clock::now();
+        event_log::replay(LOG_PATH, roster);
+        report("event_log", "replay", d, n, n,
+               chrono::duration<double>(Clock::now() - start).count(), none);
+    }
+    remove(LOG_PATH);
+
+    // the same records as a text file, loaded on every core
+    FILE* out = fopen(RECORDS_PATH, "w");
+    if (out == nullptr) {
+        fprintf(stderr, "bench: cannot open %s\n", RECORDS_PATH);
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        fprintf(out, "record %d %d %d\n", records[i].game, records[i].player, records[i].points);
+    }
+    fclose(out);
+    {
+        roster_metrics roster;
+        vector<uint32_t> none;
+        Clock::time_point start = Clock::now();
+        roster.load_records(RECORDS_PATH);
+        report("roster", "load_records", d, n, n,
+               chrono::duration<double>(Clock::now() - start).count(), none);
+    }
+    remove(RECORDS_PATH);
+}
+
+int main(int argc, char** argv) {
+    size_t maxN = 10000000;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--csv") == 0) {
+            csv = true;
+        } else {
+            maxN = strtoull(argv[i], nullptr, 10);
+        }
+    }
+    if (csv) {
+        printf("bench,op,dist,n,ops,seconds,ops_per_sec,p50_ns,p99_ns,peak_rss_kb\n");
+    }
+
+    const char* dists[] = {"sequential", "random", "skewed"};
+    mt19937_64 rng(20240101);
+    for (size_t n = 1000; n <= maxN; n *= 10) {
+        for (int d = 0; d < 3; ++d) {
+            benchTree(dists[d], n, rng);
+            benchRoster(dists[d], n, rng);
+        }
+    }
+    return 0;
+}
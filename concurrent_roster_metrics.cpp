@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <mutex>
+#include "concurrent_roster_metrics.h"
+using namespace std;
+
+concurrent_roster_metrics::concurrent_roster_metrics(int shardCount) {
+    for (int i = 0; i < max(shardCount, 1); ++i) {
+        shards.push_back(new Shard());
+    }
+}
+
+concurrent_roster_metrics::~concurrent_roster_metrics() {
+    for (size_t i = 0; i < shards.size(); ++i) {
+        delete shards[i];
+    }
+}
+
+// game ids are mostly sequential, so a multiplicative hash spreads
+// neighbouring games across shards
+size_t concurrent_roster_metrics::shardIndex(int game) const {
+    uint32_t h = (uint32_t)game * 2654435761u;
+    return h % shards.size();
+}
+
+// mutator functions
+
+//record(g, r, p) | only game g's shard is locked
+void concurrent_roster_metrics::record(int game, int player, int points) {
+    Shard& shard = *shards[shardIndex(game)];
+    unique_lock<shared_mutex> guard(shard.lock);
+    shard.metrics.record(game, player, points);
+}
+
+//clear(g, r) | only game g's shard is locked
+void concurrent_roster_metrics::clear(int game, int player) {
+    Shard& shard = *shards[shardIndex(game)];
+    unique_lock<shared_mutex> guard(shard.lock);
+    shard.metrics.clear(game, player);
+}
+
+//record_batch(records) | split the batch by shard and take each
+//shard's lock once for its whole share
+void concurrent_roster_metrics::record_batch(span<const Record> records) {
+    vector<vector<Record> > perShard(shards.size());
+    for (size_t i = 0; i < records.size(); ++i) {
+        perShard[shardIndex(records[i].game)].push_back(records[i]);
+    }
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (!perShard[s].empty()) {
+            unique_lock<shared_mutex> guard(shards[s]->lock);
+            shards[s]->metrics.record_batch(perShard[s]);
+        }
+    }
+}
+
+// accessor functions
+
+//ranked_receiver(k) | kth highest performance over every shard
+//every shard is read-locked in a fixed order, so the answer reflects
+//one consistent state. The kth highest overall is found by order
+//statistics on the shard trees: repeatedly take the median of the
+//widest remaining candidate range, count how many performances in
+//every shard rank below it, and narrow each shard's range to the
+//side that must hold the answer.
+int concurrent_roster_metrics::ranked_receiver(int rank) const {
+    vector<shared_lock<shared_mutex> > guards;
+    guards.reserve(shards.size());
+    for (size_t s = 0; s < shards.size(); ++s) {
+        guards.emplace_back(shards[s]->lock);
+    }
+
+    // per-shard 1-based candidate ranges [lo, hi] in ascending order
+    size_t count = shards.size();
+    vector<int> lo(count, 1), hi(count);
+    int total = 0;
+    for (size_t s = 0; s < count; ++s) {
+        hi[s] = shards[s]->metrics.performances().Size();
+        total += hi[s];
+    }
+    if (rank < 1 || rank > total) {
+        return -1; // rank not found
+    }
+    int target = total - rank + 1; // kth highest = target-th smallest
+
+    while (true) {
+        // median of the widest remaining range
+        size_t widest = 0;
+        for (size_t s = 1; s < count; ++s) {
+            if (hi[s] - lo[s] > hi[widest] - lo[widest]) {
+                widest = s;
+            }
+        }
+        int mid = lo[widest] + (hi[widest] - lo[widest]) / 2;
+        const PerformanceTree::Node* candidate =
+            shards[widest]->metrics.performances().select(mid);
+        Performance key = candidate->key;
+
+        // candidate's overall rank; keys never repeat across shards
+        // because every game lives in exactly one shard
+        vector<int> below(count);
+        int position = 1;
+        for (size_t s = 0; s < count; ++s) {
+            below[s] = (s == widest) ? mid - 1 : shards[s]->metrics.performances().count_less(key);
+            position += below[s];
+        }
+
+        if (position == target) {
+            return candidate->secondValue;
+        } else if (position < target) {
+            for (size_t s = 0; s < count; ++s) {
+                lo[s] = max(lo[s], below[s] + 1 + (s == widest ? 1 : 0));
+            }
+        } else {
+            for (size_t s = 0; s < count; ++s) {
+                hi[s] = min(hi[s], below[s]);
+            }
+        }
+    }
+}
+
+//stats() | roster_metrics::stats() summed over the shards, each read
+//locked in turn
+roster_stats concurrent_roster_metrics::stats() const {
+    roster_stats out;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        shared_lock<shared_mutex> guard(shards[s]->lock);
+        out += shards[s]->metrics.stats();
+    }
+    return out;
+}
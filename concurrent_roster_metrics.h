@@ -0,0 +1,41 @@
+#ifndef CONCURRENT_ROSTER_METRICS_H
+#define CONCURRENT_ROSTER_METRICS_H
+#include <shared_mutex>
+#include <span>
+#include <vector>
+#include "roster_metrics.h"
+
+// roster_metrics that many threads can record into at once. Games are
+// spread over shards by id; each shard is a full roster_metrics (its
+// own game tree, per-game trees and performance tree) behind its own
+// lock, so records for games in different shards never contend.
+// ranked_receiver merges the per-shard performance trees at query time.
+class concurrent_roster_metrics {
+    private:
+        // one lock and roster per cache-line-aligned slot, so writers
+        // on neighbouring shards do not false-share
+        struct alignas(64) Shard {
+            mutable shared_mutex lock;
+            roster_metrics metrics;
+        };
+        vector<Shard*> shards;
+
+        size_t shardIndex(int game) const;
+    public:
+        // constructor
+        explicit concurrent_roster_metrics(int shardCount = 64);
+        ~concurrent_roster_metrics();
+        concurrent_roster_metrics(const concurrent_roster_metrics&) = delete;
+        concurrent_roster_metrics& operator=(const concurrent_roster_metrics&) = delete;
+
+        // mutator functions, safe to call from any thread
+        void record(int game, int player, int points);
+        void clear(int game, int player);
+        void record_batch(span<const Record> records);
+
+        // accessor functions, consistent across all shards
+        int ranked_receiver(int rank) const;
+        roster_stats stats() const;
+};
+
+#endif
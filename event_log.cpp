@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "event_log.h"
+#include "roster_snapshot.h"
+using namespace std;
+
+struct BatchHeader {
+    uint32_t count;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+// read exactly bytes, or report a short read
+static bool readFully(int fd, void* data, size_t bytes) {
+    char* p = (char*)data;
+    while (bytes > 0) {
+        ssize_t n = read(fd, p, bytes);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t bytes) {
+    const char* p = (const char*)data;
+    while (bytes > 0) {
+        ssize_t n = write(fd, p, bytes);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+// walk the batches of an open log from just past the magic. Calls
+// visit(events) for each intact batch; returns the offset where the
+// intact part of the log ends. A count claiming more events than the
+// file still holds is a torn or corrupt header, not an allocation.
+template <class Visit>
+static off_t scanBatches(int fd, Visit visit) {
+    off_t end = sizeof(EVENT_LOG_MAGIC);
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        return end;
+    }
+    vector<Event> events;
+    BatchHeader header;
+    while (readFully(fd, &header, sizeof(header))) {
+        uint64_t left = info.st_size - (end + sizeof(header));
+        if ((uint64_t)header.count * sizeof(Event) > left) {
+            break; // count runs past the end of the file
+        }
+        events.resize(header.count);
+        if (!readFully(fd, events.data(), header.count * sizeof(Event)) ||
+            snapshot_checksum(events.data(), header.count * sizeof(Event)) != header.checksum) {
+            break; // torn or corrupt tail
+        }
+        visit(events);
+        end += sizeof(header) + header.count * sizeof(Event);
+    }
+    return end;
+}
+
+event_log::event_log() {
+    fd = -1;
+    batchSize = 4096;
+    committed = 0;
+    goodEnd = 0;
+    failed = false;
+}
+
+event_log::~event_log() {
+    close();
+}
+
+//open(path, batchSize) | open or create a log for appending. A torn
+//batch left by a crash is cut off so new batches follow the last
+//intact one.
+bool event_log::open(const char* path, size_t size) {
+    close();
+    fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    batchSize = max(size, (size_t)1);
+    committed = 0;
+    goodEnd = sizeof(EVENT_LOG_MAGIC);
+    failed = false;
+
+    char magic[sizeof(EVENT_LOG_MAGIC)];
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close();
+        return false;
+    }
+    if (info.st_size == 0) {
+        if (!writeFully(fd, EVENT_LOG_MAGIC, sizeof(magic)) || fdatasync(fd) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+    if (!readFully(fd, magic, sizeof(magic)) || memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0) {
+        close();
+        return false;
+    }
+    off_t end = scanBatches(fd, [this](const vector<Event>& events) { committed += events.size(); });
+    if (ftruncate(fd, end) != 0 || lseek(fd, end, SEEK_SET) != end) {
+        close();
+        return false;
+    }
+    goodEnd = end;
+    return true;
+}
+
+//close() | commit anything pending and close the file
+bool event_log::close() {
+    bool ok = true;
+    if (fd >= 0) {
+        ok = commit();
+        ::close(fd);
+    }
+    fd = -1;
+    pending.clear();
+    return ok;
+}
+
+//append(event) | buffer an event; a full buffer is group-committed
+bool event_log::append(const Event& event) {
+    if (failed) {
+        return false;
+    }
+    pending.push_back(event);
+    if (pending.size() >= batchSize) {
+        return commit();
+    }
+    return true;
+}
+
+//commit() | write the pending events as one batch and make it
+//durable with a single fdatasync. A failed write is cut back off the
+//file, so a later commit can retry the batch; if even that fails the
+//log refuses every later append and commit.
+bool event_log::commit() {
+    if (failed) {
+        return false;
+    }
+    if (pending.empty()) {
+        return true;
+    }
+    if (fd < 0) {
+        return false;
+    }
+    BatchHeader header;
+    header.count = pending.size();
+    header.reserved = 0;
+    header.checksum = snapshot_checksum(pending.data(), pending.size() * sizeof(Event));
+
+    // header and events go out in one write so a batch is never split
+    // across two partially flushed writes
+    vector<char> buffer(sizeof(header) + pending.size() * sizeof(Event));
+    memcpy(buffer.data(), &header, sizeof(header));
+    memcpy(buffer.data() + sizeof(header), pending.data(), pending.size() * sizeof(Event));
+    if (!writeFully(fd, buffer.data(), buffer.size()) || fdatasync(fd) != 0) {
+        if (ftruncate(fd, goodEnd) != 0 || lseek(fd, goodEnd, SEEK_SET) != goodEnd) {
+            failed = true;
+        }
+        return false;
+    }
+    goodEnd += buffer.size();
+    committed += pending.size();
+    pending.clear();
+    return true;
+}
+
+//reset() | drop every event, e.g. once a snapshot covers them
+bool event_log::reset() {
+    pending.clear();
+    committed = 0;
+    off_t start = sizeof(EVENT_LOG_MAGIC);
+    if (fd < 0 || ftruncate(fd, start) != 0 || lseek(fd, start, SEEK_SET) != start || fdatasync(fd) != 0) {
+        return false;
+    }
+    goodEnd = start;
+    failed = false;
+    return true;
+}
+
+uint64_t event_log::committed_events() const {
+    return committed;
+}
+
+//replay(path, roster) | apply every committed event in the log to
+//roster. record replaces and clear removes, so replaying a log over
+//a snapshot taken part way through it still ends in the same state.
+bool event_log::replay(const char* path, roster_metrics& roster, uint64_t* applied) {
+    int in = ::open(path, O_RDONLY);
+    if (in < 0) {
+        return false;
+    }
+    char magic[sizeof(EVENT_LOG_MAGIC)];
+    if (!readFully(in, magic, sizeof(magic)) || memcmp(magic, EVENT_LOG_MAGIC, sizeof(magic)) != 0) {
+        ::close(in);
+        return false;
+    }
+    uint64_t count = 0;
+    scanBatches(in, [&](const vector<Event>& events) {
+        apply_events(events, roster);
+        count += events.size();
+    });
+    ::close(in);
+    if (applied != nullptr) {
+        *applied = count;
+    }
+    return true;
+}
+
+//apply_events(events, roster) | see event_log.h
+void apply_events(span<const Event> events, roster_metrics& roster) {
+    vector<Event> byGame(events.begin(), events.end());
+    stable_sort(byGame.begin(), byGame.end(),
+                [](const Event& a, const Event& b) { return a.game < b.game; });
+
+    vector<Record> records;
+    for (size_t i = 0; i < byGame.size(); ++i) {
+        const Event& e = byGame[i];
+        if (e.type == EVENT_RECORD) {
+            Record r = {e.game, e.player, e.points};
+            records.push_back(r);
+        } else if (e.type == EVENT_CLEAR) {
+            // earlier records for this game must land before the clear
+            roster.record_batch(records);
+            records.clear();
+            roster.clear(e.game, e.player);
+        }
+    }
+    roster.record_batch(records);
+}
+
+//parse_event(line, e) | see event_log.h
+bool parse_event(const char* line, Event& e) {
+    char verb[16];
+    e.points = 0;
+    if (sscanf(line, "%15s %d %d %d", verb, &e.game, &e.player, &e.points) == 4 &&
+        strcmp(verb, "record") == 0) {
+        e.type = EVENT_RECORD;
+        return true;
+    }
+    if (sscanf(line, "%15s %d %d", verb, &e.game, &e.player) == 3 &&
+        strcmp(verb, "clear") == 0) {
+        e.type = EVENT_CLEAR;
+        e.points = 0;
+        return true;
+    }
+    return false;
+}
+
+//ingest_stream(in, roster, log, batchSize) | see event_log.h
+uint64_t ingest_stream(FILE* in, roster_metrics& roster, event_log* log, size_t batchSize,
+                       bool* failed) {
+    uint64_t applied = 0;
+    if (failed != nullptr) {
+        *failed = false;
+    }
+    vector<Event> batch;
+    batch.reserve(batchSize);
+    char line[256];
+
+    while (true) {
+        bool more = fgets(line, sizeof(line), in) != nullptr;
+        if (more) {
+            if (strchr(line, '\n') == nullptr && !feof(in)) {
+                // longer than the buffer: skip the rest of it rather
+                // than parse its tail as a line of its own
+                int c;
+                while ((c = fgetc(in)) != EOF && c != '\n') {
+                }
+                continue; // malformed line
+            }
+            Event e;
+            if (!parse_event(line, e)) {
+                continue; // malformed line
+            }
+            batch.push_back(e);
+        }
+        if (batch.size() >= batchSize || (!more && !batch.empty())) {
+            // log first so nothing is applied that a crash could lose
+            if (log != nullptr) {
+                bool logged = true;
+                for (size_t i = 0; i < batch.size() && logged; ++i) {
+                    logged = log->append(batch[i]);
+                }
+                if (!logged || !log->commit()) {
+                    if (failed != nullptr) {
+                        *failed = true;
+                    }
+                    return applied;
+                }
+            }
+            apply_events(batch, roster);
+            applied += batch.size();
+            batch.clear();
+        }
+        if (!more) {
+            return applied;
+        }
+    }
+}
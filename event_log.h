@@ -0,0 +1,84 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <span>
+#include <vector>
+#include "roster_metrics.h"
+using namespace std;
+
+// one record(g, r, p) or clear(g, r) call
+struct Event {
+    int32_t type;     // EVENT_RECORD or EVENT_CLEAR
+    int32_t game;
+    int32_t player;
+    int32_t points;   // unused for EVENT_CLEAR
+};
+
+const int32_t EVENT_RECORD = 1;
+const int32_t EVENT_CLEAR = 2;
+
+//------------------------------------------------------------------
+// Write-ahead log file
+//
+//   char magic[8]
+//   batches, each:
+//     uint32_t count
+//     uint32_t reserved
+//     uint64_t checksum of events[]
+//     Event    events[count]
+//
+// A batch is written and fdatasync'd as a unit (group commit), so a
+// crash can only lose or tear the batch being written; replay stops
+// at the first batch that is short or fails its checksum.
+//------------------------------------------------------------------
+
+const char EVENT_LOG_MAGIC[8] = {'R', 'O', 'S', 'T', 'W', 'A', 'L', '1'};
+
+class event_log {
+    private:
+        int fd;
+        vector<Event> pending;   // appended but not yet committed
+        size_t batchSize;
+        uint64_t committed;      // events durable in the file
+        off_t goodEnd;           // file offset after the last good batch
+        bool failed;             // a torn write could not be undone
+    public:
+        // constructor
+        event_log();
+        ~event_log();
+        event_log(const event_log&) = delete;
+        event_log& operator=(const event_log&) = delete;
+
+        bool open(const char* path, size_t batchSize = 4096);
+        bool close();
+        bool append(const Event& event);
+        bool commit();
+        bool reset();
+        uint64_t committed_events() const;
+
+        static bool replay(const char* path, roster_metrics& roster, uint64_t* applied = nullptr);
+};
+
+// Apply events to roster grouped by game. Events for different games
+// commute, so each game's events run back to back (in their original
+// order) and consecutive records go through record_batch.
+void apply_events(span<const Event> events, roster_metrics& roster);
+
+// Parse one text event, "record <game> <jersey> <points>" or "clear
+// <game> <jersey>", into e. Returns false for a malformed line.
+bool parse_event(const char* line, Event& e);
+
+// Streaming ingestion: read text events from in (a file or pipe), one
+// per line as "record <game> <jersey> <points>" or "clear <game>
+// <jersey>". Every batchSize events are appended to log (if any) as
+// one group commit and then applied with apply_events. Returns the
+// number of events applied; malformed lines, and lines of 255 bytes
+// or more, are skipped. If a batch
+// cannot be logged, ingestion stops before applying it and *failed
+// (if given) is set.
+uint64_t ingest_stream(FILE* in, roster_metrics& roster, event_log* log, size_t batchSize = 4096,
+                       bool* failed = nullptr);
+
+#endif
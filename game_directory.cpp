@@ -0,0 +1,96 @@
+#include <algorithm>
+#include "game_directory.h"
+using namespace std;
+
+game_directory::game_directory() {
+    used = 0;
+    live = 0;
+}
+
+// first probe position; game ids are mostly sequential, so a
+// multiplicative hash spreads neighbours across the table
+size_t game_directory::home(int game) const {
+    uint32_t h = (uint32_t)game * 2654435761u;
+    return h & (table.size() - 1);
+}
+
+// rebuild into a table of capacity entries, dropping tombstones
+void game_directory::rehash(size_t capacity) {
+    vector<Entry> old;
+    old.swap(table);
+    Entry empty = {0, EMPTY};
+    table.assign(capacity, empty);
+    used = 0;
+    live = 0;
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i].slot >= 0) {
+            insert(old[i].game, old[i].slot);
+        }
+    }
+}
+
+//find(g) | slot of game g, or -1
+int game_directory::find(int game) const {
+    if (table.empty()) {
+        return -1;
+    }
+    size_t mask = table.size() - 1;
+    for (size_t i = home(game); ; i = (i + 1) & mask) {
+        const Entry& e = table[i];
+        if (e.slot == EMPTY) {
+            return -1;
+        }
+        if (e.slot != ERASED && e.game == game) {
+            return e.slot;
+        }
+    }
+}
+
+//insert(g, slot) | map game g to slot (g must not be present)
+void game_directory::insert(int game, int slot) {
+    if ((used + 1) * 2 > table.size()) {
+        // grow only if live entries fill the table; otherwise a
+        // same-size rehash is enough to clear the tombstones
+        rehash(max<size_t>(16, (live + 1) * 4 > table.size() ? table.size() * 2 : table.size()));
+    }
+    size_t mask = table.size() - 1;
+    size_t i = home(game);
+    while (table[i].slot >= 0) {
+        i = (i + 1) & mask;
+    }
+    if (table[i].slot == EMPTY) {
+        ++used;
+    }
+    table[i].game = game;
+    table[i].slot = slot;
+    ++live;
+}
+
+//erase(g) | forget game g; returns false if it was not present
+bool game_directory::erase(int game) {
+    if (table.empty()) {
+        return false;
+    }
+    size_t mask = table.size() - 1;
+    for (size_t i = home(game); ; i = (i + 1) & mask) {
+        Entry& e = table[i];
+        if (e.slot == EMPTY) {
+            return false;
+        }
+        if (e.slot != ERASED && e.game == game) {
+            e.slot = ERASED;
+            --live;
+            return true;
+        }
+    }
+}
+
+void game_directory::clear() {
+    table.clear();
+    used = 0;
+    live = 0;
+}
+
+size_t game_directory::size() const {
+    return live;
+}
@@ -0,0 +1,38 @@
+#ifndef GAME_DIRECTORY_H
+#define GAME_DIRECTORY_H
+#include <stdint.h>
+#include <vector>
+using namespace std;
+
+// Open-addressing hash from game id to its slot in
+// roster_metrics::gameRosters, so record/clear find a game's tree in
+// O(1) instead of a gameTree descent. Linear probing over a
+// power-of-two table kept at most half full; erased entries leave
+// tombstones that the next rehash sweeps away.
+class game_directory {
+    private:
+        struct Entry {
+            int game;
+            int slot;   // EMPTY, ERASED or a gameRosters index
+        };
+        static const int EMPTY = -1;
+        static const int ERASED = -2;
+
+        vector<Entry> table;
+        size_t used;    // live entries plus tombstones
+        size_t live;
+
+        size_t home(int game) const;
+        void rehash(size_t capacity);
+    public:
+        // constructor
+        game_directory();
+
+        int find(int game) const;
+        void insert(int game, int slot);
+        bool erase(int game);
+        void clear();
+        size_t size() const;
+};
+
+#endif
@@ -1,11 +1,24 @@
+#include <algorithm>
+#include <atomic>
+#include <csignal>
 #include <iostream>
 
 #include <assert.h>
+#include <sys/resource.h>
 
+#include <thread>
+#include <vector>
+
+#include "BPlusTree.h"
+#include "concurrent_roster_metrics.h"
+#include "event_log.h"
+#include "game_directory.h"
+#include "reclaimer.h"
+#include "roster_snapshot.h"
 #include "roster_metrics.h"
 
 void test() {
-    roster_metrics roster = roster_metrics();
+    roster_metrics roster;
     roster.record(1, 1, 10);
     roster.record(1, 2, 5);
     roster.record(1, 3, 15);
@@ -14,16 +27,956 @@ void test() {
     roster.record(2, 3, 30);
 
     assert(roster.ranked_receiver(1)==3);
+    assert(roster.ranked_receiver(5)==2);
+    assert(roster.ranked_receiver(6)==2);
+    assert(roster.ranked_receiver(7)==-1);
+
+    std::vector<int> top = roster.top_k(3);
+    assert(top.size()==3 && top[0]==3 && top[1]==3 && top[2]==1);
+    std::vector<int> tail = roster.ranked_range(5, 10);
+    assert(tail.size()==2 && tail[0]==2 && tail[1]==2);
 
     roster.clear(2,3);
 
-    assert(roster.ranked_receiver(1)==1);
+    // 15 points by jersey 3 in game 1 is now the best performance
+    assert(roster.ranked_receiver(1)==3);
+    assert(roster.ranked_receiver(2)==1);
+    assert(roster.ranked_receiver(6)==-1);
+
+    // clearing one of two tied 10-point games leaves the other
+    roster.clear(1,1);
+    assert(roster.ranked_receiver(2)==1);
+    assert(roster.ranked_receiver(3)==2);
+
+    // re-recording a jersey replaces its earlier points
+    roster.record(1, 2, 40);
+    assert(roster.ranked_receiver(1)==2);
+    assert(roster.ranked_receiver(4)==2);
+    assert(roster.ranked_receiver(5)==-1);
 
     std::cout << "Test succeeded!" << std::endl;
 }
 
+void testBatch() {
+    // the same season as test(), loaded in one call, plus a
+    // replacement of jersey 2's game 1 points
+    Record season[] = {
+        {1, 1, 10}, {2, 3, 30}, {1, 2, 5}, {1, 3, 15},
+        {2, 1, 10}, {2, 2, 0}, {1, 2, 7},
+    };
+    roster_metrics roster;
+    roster.record_batch(season);
+
+    assert(roster.ranked_receiver(1)==3);
+    assert(roster.ranked_receiver(5)==2);
+    assert(roster.ranked_receiver(7)==-1);
+
+    // batches merge with what is already recorded
+    Record more[] = {{2, 3, 1}, {3, 9, 50}};
+    roster.record_batch(more);
+    assert(roster.ranked_receiver(1)==9);
+    assert(roster.ranked_receiver(2)==3);
+    assert(roster.ranked_receiver(6)==3);
+    roster.clear(3, 9);
+    assert(roster.ranked_receiver(1)==3);
+
+    std::cout << "Batch test succeeded!" << std::endl;
+}
+
+void testSeasonTotals() {
+    roster_metrics roster;
+    roster.record(1, 1, 10);
+    roster.record(1, 2, 5);
+    roster.record(2, 1, 7);
+    roster.record(2, 3, 30);
+    roster.record(3, 2, 4);
+
+    PlayerTree season;
+    roster.season_totals(season, 2);
+    assert(season.Size()==3);
+    assert(season.search(1)->secondValue==17);
+    assert(season.search(2)->secondValue==9);
+    assert(season.search(3)->secondValue==30);
+
+    // the maintained leaderboard agrees and follows record/clear
+    assert(roster.ranked_season_receiver(1)==3);
+    assert(roster.ranked_season_receiver(2)==1);
+    assert(roster.ranked_season_receiver(3)==2);
+    assert(roster.ranked_season_receiver(4)==-1);
+    roster.record(2, 3, 1);
+    roster.record(3, 2, 20);
+    assert(roster.season_points(3)==1 && roster.season_points(2)==25);
+    assert(roster.ranked_season_receiver(1)==2 && roster.ranked_season_receiver(3)==3);
+    roster.clear(2, 3);
+    assert(roster.season_points(3)==-1 && roster.ranked_season_receiver(3)==-1);
+
+    // split and join are inverses on a tree sharing one pool
+    PlayerTree low(season.node_pool()), high(season.node_pool());
+    assert(season.split(2, low, high));
+    assert(low.Size()==1 && high.Size()==1 && season.Size()==0);
+    season.join(low, 2, 9, high);
+    assert(season.Size()==3 && season.rank_of(3)==3);
+
+    std::cout << "Season totals test succeeded!" << std::endl;
+}
+
+void testSnapshots() {
+    roster_metrics roster;
+    roster.record(1, 1, 10);
+    roster.enable_snapshots();
+    roster.record(1, 2, 20);
+
+    PerformanceSnapshot before = roster.snapshot();
+    roster.record(2, 3, 30);
+    roster.clear(1, 2);
+
+    // the old snapshot still sees the version it pinned
+    assert(roster_metrics::ranked_receiver(before, 1)==2);
+    assert(roster_metrics::ranked_receiver(before, 3)==-1);
+    PerformanceSnapshot after = roster.snapshot();
+    assert(roster_metrics::ranked_receiver(after, 1)==3);
+    assert(roster_metrics::ranked_receiver(after, 2)==1);
+
+    // a batch, replaces included, is published as one version: large
+    // batches by a rebuild, small ones by path copies
+    roster_metrics batched;
+    for (int player = 1; player <= 200; ++player) {
+        batched.record(player % 10, player, player);
+    }
+    batched.enable_snapshots();
+    std::vector<Record> large, small;
+    for (int player = 1; player <= 150; ++player) {
+        Record r = {player % 10, player, 1000 + player};   // replaces
+        large.push_back(r);
+    }
+    for (int player = 201; player <= 250; ++player) {
+        Record r = {player % 10, player, player};
+        large.push_back(r);
+    }
+    Record replace = {5, 5, 7}, added = {3, 251, 2};
+    small.push_back(replace);
+    small.push_back(added);
+    std::atomic<bool> done(false);
+    std::thread reader([&batched, &done]() {
+        while (!done) {
+            int size = batched.snapshot().Size();
+            assert(size==200 || size==250 || size==251);
+        }
+    });
+    batched.record_batch(large);
+    batched.record_batch(small);
+    done = true;
+    reader.join();
+    PerformanceSnapshot last = batched.snapshot();
+    for (int rank = 1; rank <= 252; ++rank) {
+        assert(roster_metrics::ranked_receiver(last, rank)==batched.ranked_receiver(rank));
+    }
+
+    std::cout << "Snapshot test succeeded!" << std::endl;
+}
+
+void testConcurrent() {
+    // four writers on disjoint games must agree with a serial roster
+    concurrent_roster_metrics shared(8);
+    roster_metrics serial;
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 4; ++w) {
+        writers.emplace_back([&shared, w]() {
+            for (int game = w; game < 40; game += 4) {
+                for (int player = 1; player <= 10; ++player) {
+                    shared.record(game, player, (game * 7 + player * 13) % 50);
+                }
+                shared.clear(game, 5);
+            }
+        });
+    }
+    for (size_t w = 0; w < writers.size(); ++w) {
+        writers[w].join();
+    }
+    for (int game = 0; game < 40; ++game) {
+        for (int player = 1; player <= 10; ++player) {
+            serial.record(game, player, (game * 7 + player * 13) % 50);
+        }
+        serial.clear(game, 5);
+    }
+
+    for (int rank = 0; rank <= 362; ++rank) {
+        assert(shared.ranked_receiver(rank)==serial.ranked_receiver(rank));
+    }
+
+    std::cout << "Concurrent test succeeded!" << std::endl;
+}
+
+// apply edit to a snapshot's payload and reseal every checksum, making
+// a file that is intact on disk but wrong inside
+template <class Edit>
+static void resealSnapshot(const char* path, Edit edit) {
+    FILE* file = fopen(path, "rb");
+    std::vector<char> bytes;
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        bytes.push_back((char)c);
+    }
+    fclose(file);
+    SnapshotHeader* header = (SnapshotHeader*)bytes.data();
+    size_t blocks = (header->payloadBytes + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    uint64_t* table = (uint64_t*)(bytes.data() + sizeof(SnapshotHeader));
+    char* payload = (char*)(table + blocks);
+    SnapshotGame* games = (SnapshotGame*)payload;
+    SnapshotPlayer* players = (SnapshotPlayer*)(games + header->gameCount);
+    SnapshotPerformance* performances = (SnapshotPerformance*)(players + header->playerCount);
+    edit(games, players, performances);
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t start = b * SNAPSHOT_BLOCK_SIZE;
+        table[b] = snapshot_checksum(payload + start, std::min(SNAPSHOT_BLOCK_SIZE, (size_t)header->payloadBytes - start));
+    }
+    header->tableChecksum = snapshot_checksum(table, blocks * sizeof(uint64_t));
+    header->headerChecksum = snapshot_checksum(header, offsetof(SnapshotHeader, headerChecksum));
+    file = fopen(path, "wb");
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+void testSnapshotFile() {
+    const char* path = "roster_test.snapshot";
+    roster_metrics roster;
+    for (int game = 1; game <= 30; ++game) {
+        for (int player = 1; player <= 20; ++player) {
+            roster.record(game, player, (game * 31 + player * 17) % 60);
+        }
+    }
+    assert(roster.save_snapshot(path));
+
+    // the mapped, read-only roster answers without a rebuild
+    mapped_roster mapped;
+    assert(mapped.open(path));
+    for (int rank = 1; rank <= 601; ++rank) {
+        assert(mapped.ranked_receiver(rank)==roster.ranked_receiver(rank));
+    }
+    assert(mapped.points(7, 3)==roster.points(7, 3));
+    assert(mapped.points(31, 1)==-1);
+
+    // queries from several threads verify blocks side by side
+    assert(mapped.open(path));
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&mapped, &roster, t]() {
+            for (int rank = 1 + t; rank <= 600; rank += 4) {
+                assert(mapped.ranked_receiver(rank)==roster.ranked_receiver(rank));
+                assert(mapped.points(rank % 30 + 1, t + 1)==roster.points(rank % 30 + 1, t + 1));
+            }
+        });
+    }
+    for (size_t t = 0; t < readers.size(); ++t) {
+        readers[t].join();
+    }
+    assert(!mapped.is_corrupt());
+    mapped.close();
+
+    // a restored roster behaves like the original
+    roster_metrics restored;
+    assert(restored.load_snapshot(path));
+    assert(restored.points(12, 20)==roster.points(12, 20));
+    restored.clear(1, 1);
+    roster.clear(1, 1);
+    assert(restored.ranked_receiver(100)==roster.ranked_receiver(100));
+
+    // snapshot readers see the old index or the loaded one, never a mix
+    roster_metrics watched;
+    watched.record(99, 1, 5);
+    watched.enable_snapshots();
+    std::atomic<bool> done(false);
+    std::thread reader([&watched, &done]() {
+        while (!done) {
+            int size = watched.snapshot().Size();
+            assert(size==1 || size==600);
+        }
+    });
+    assert(watched.load_snapshot(path));
+    done = true;
+    reader.join();
+    assert(watched.snapshot().Size()==600);
+
+    // sealed but inconsistent files are refused, leaving the roster be
+    const char* bad = "roster_test_bad.snapshot";
+    assert(roster.save_snapshot(bad));
+    resealSnapshot(bad, [](SnapshotGame* g, SnapshotPlayer*, SnapshotPerformance*) { g[29].playerCount = 1000; });
+    assert(!mapped.open(bad) && !restored.load_snapshot(bad));
+    assert(roster.save_snapshot(bad));
+    resealSnapshot(bad, [](SnapshotGame* g, SnapshotPlayer*, SnapshotPerformance*) { std::swap(g[3], g[4]); });
+    assert(!mapped.open(bad));
+    assert(roster.save_snapshot(bad));
+    resealSnapshot(bad, [](SnapshotGame*, SnapshotPlayer* p, SnapshotPerformance*) { std::swap(p[0], p[1]); });
+    assert(mapped.open(bad) && !restored.load_snapshot(bad));
+    assert(roster.save_snapshot(bad));
+    resealSnapshot(bad, [](SnapshotGame*, SnapshotPlayer*, SnapshotPerformance* p) { std::swap(p[0], p[598]); });
+    assert(!restored.load_snapshot(bad));
+    assert(restored.ranked_receiver(100)==roster.ranked_receiver(100) && restored.points(1, 1)==-1);
+    mapped.close();
+
+    // a file written on a host of the other byte order is refused
+    assert(roster.save_snapshot(bad));
+    FILE* swapped = fopen(bad, "r+b");
+    SnapshotHeader header;
+    assert(fread(&header, sizeof(header), 1, swapped) == 1);
+    header.byteOrder = __builtin_bswap32(header.byteOrder);
+    header.headerChecksum = snapshot_checksum(&header, offsetof(SnapshotHeader, headerChecksum));
+    fseek(swapped, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, swapped);
+    fclose(swapped);
+    assert(!mapped.open(bad) && !restored.load_snapshot(bad));
+    remove(bad);
+
+    // flip one payload byte: the block checksum must catch it
+    FILE* file = fopen(path, "r+b");
+    fseek(file, -5, SEEK_END);
+    int byte = fgetc(file);
+    fseek(file, -5, SEEK_END);
+    fputc(byte ^ 0x40, file);
+    fclose(file);
+    assert(mapped.open(path));
+    assert(mapped.ranked_receiver(1)==-1 && mapped.is_corrupt());
+    assert(!restored.load_snapshot(path));
+    remove(path);
+
+    std::cout << "Snapshot file test succeeded!" << std::endl;
+}
+
+void testEventLog() {
+    const char* path = "roster_test.wal";
+    const char* feed = "roster_test.feed";
+    remove(path);
+
+    FILE* out = fopen(feed, "w");
+    for (int game = 1; game <= 10; ++game) {
+        for (int player = 1; player <= 12; ++player) {
+            fprintf(out, "record %d %d %d\n", game, player, (game * 7 + player * 13) % 40);
+        }
+    }
+    fprintf(out, "clear 3 4\nnot an event\nrecord 3 4 99\nclear 5 5\n");
+    // an overlong line is dropped whole, not split into a bogus event
+    fprintf(out, "clear 3 4 %300s record 1 2 3\n", "");
+    fclose(out);
+
+    roster_metrics live;
+    event_log log;
+    assert(log.open(path, 16));
+    FILE* in = fopen(feed, "r");
+    bool failed = true;
+    assert(ingest_stream(in, live, &log, 50, &failed)==123 && !failed);
+    fclose(in);
+    assert(log.committed_events()==123);
+    assert(live.points(3, 4)==99 && live.points(5, 5)==-1);
+    assert(log.close());
+
+    // restart: replaying the log rebuilds the same roster
+    roster_metrics replayed;
+    uint64_t applied = 0;
+    assert(event_log::replay(path, replayed, &applied) && applied==123);
+    for (int rank = 1; rank <= 120; ++rank) {
+        assert(replayed.ranked_receiver(rank)==live.ranked_receiver(rank));
+    }
+
+    // a torn final batch is dropped on replay and cut off on reopen
+    FILE* file = fopen(path, "ab");
+    fputs("torn", file);
+    fclose(file);
+    assert(log.open(path));
+    assert(log.committed_events()==123);
+    Event e = {EVENT_RECORD, 11, 1, 5};
+    assert(log.append(e) && log.commit());
+    assert(log.close());
+    roster_metrics again;
+    assert(event_log::replay(path, again, &applied) && applied==124);
+    assert(again.points(11, 1)==5);
+
+    // a header whose count runs past the file ends the log there
+    file = fopen(path, "ab");
+    unsigned int huge[4] = {0xFFFFFFFFu, 0, 0, 0};
+    fwrite(huge, sizeof(huge), 1, file);
+    fclose(file);
+    roster_metrics bogus;
+    assert(event_log::replay(path, bogus, &applied) && applied==124);
+    assert(log.open(path) && log.committed_events()==124 && log.close());
+
+    // a batch that cannot be logged is never applied
+    event_log unopened;
+    roster_metrics untouched;
+    in = fopen(feed, "r");
+    assert(ingest_stream(in, untouched, &unopened, 50, &failed)==0 && failed);
+    fclose(in);
+    assert(untouched.ranked_receiver(1)==-1);
+
+    // a write cut short by a full disk is undone, so retrying later
+    // does not leave a torn batch ahead of good ones
+    assert(log.open(path, 1000));
+    struct rlimit limit, small;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    small = limit;
+    small.rlim_cur = 124 * sizeof(Event) + 200;
+    signal(SIGXFSZ, SIG_IGN);
+    setrlimit(RLIMIT_FSIZE, &small);
+    for (int player = 1; player <= 50; ++player) {
+        Event more = {EVENT_RECORD, 12, player, player};
+        assert(log.append(more));
+    }
+    assert(!log.commit());
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, SIG_DFL);
+    assert(log.commit() && log.close());
+    roster_metrics recovered;
+    assert(event_log::replay(path, recovered, &applied) && applied==174);
+    assert(recovered.points(12, 50)==50);
+    remove(path);
+    remove(feed);
+
+    std::cout << "Event log test succeeded!" << std::endl;
+}
+
+void testStats() {
+    // ascending inserts: every third level needs a single rotation,
+    // never a double one
+    AVL_Tree<int, int, less<int>, CountingStats> tree;
+    for (int i = 1; i <= 1023; ++i) {
+        tree.Insert(i, i);
+    }
+    TreeStats counted;
+    tree.collect_stats(counted);
+    assert(counted.nodes==1023 && counted.height==10);
+    assert(counted.singleRotations==1013 && counted.doubleRotations==0);
+
+    // a search for the root key compares twice; misses go to a leaf
+    tree.search(tree.getRoot()->key);
+    tree.search(0);
+    TreeStats after;
+    tree.collect_stats(after);
+    assert(after.searches==2 && after.comparisons>=2 + 10);
+
+    for (int i = 1; i <= 1023; i += 2) {
+        tree.Delete(i);
+    }
+    TreeStats deleted;
+    tree.collect_stats(deleted);
+    assert(deleted.nodes==511 && deleted.deleteRetraces>0);
+
+    roster_metrics roster;
+    roster.record(1, 1, 10);
+    roster.record(1, 2, 5);
+    roster.record(2, 1, 7);
+    roster_stats stats = roster.stats();
+    assert(stats.gameCount==2 && stats.games.nodes==3);
+#ifdef ROSTER_BPLUS
+    assert(stats.performances.nodes==3 && stats.performances.height==1);   // one leaf
+#else
+    assert(stats.performances.nodes==3 && stats.performances.height==2);
+#endif
+
+    std::cout << "Stats test succeeded!" << std::endl;
+}
+
+void testFrozen() {
+    AVL_Tree<int, int> tree;
+    for (int i = 0; i < 1000; ++i) {
+        tree.Insert(i * 3, i);
+    }
+    FrozenTree<int, int> frozen = tree.freeze();
+    assert(frozen.Size()==1000);
+    for (int key = -2; key < 3005; ++key) {
+        const int* value = frozen.search(key);
+        if (key >= 0 && key < 3000 && key % 3 == 0) {
+            assert(value != nullptr && *value==key / 3);
+            assert(frozen.rank_of(key)==tree.rank_of(key));
+        } else {
+            assert(value == nullptr && frozen.rank_of(key)==-1);
+        }
+        assert(frozen.count_less(key)==tree.count_less(key));
+    }
+
+    // a finished game answers from the frozen copy until it changes
+    roster_metrics roster;
+    roster.record(1, 10, 7);
+    roster.record(1, 11, 9);
+    roster.record(2, 10, 3);
+    assert(roster.finish_game(1) && !roster.finish_game(3));
+    assert(roster.points(1, 10)==7 && roster.points(1, 11)==9);
+    assert(roster.points(1, 12)==-1);
+    roster.record(1, 12, 4);
+    assert(roster.points(1, 12)==4);
+    assert(roster.finish_game(1));
+    roster.clear(1, 10);
+    assert(roster.points(1, 10)==-1 && roster.points(1, 11)==9);
+
+    std::cout << "Frozen test succeeded!" << std::endl;
+}
+
+void testRangeAggregate() {
+    AVL_Tree<int, int, less<int>, NoStats, MaxAugment> best;
+    for (int i = 1; i <= 100; ++i) {
+        best.Insert(i, (i * 37) % 101);
+    }
+    // values are 1..100 shuffled; key 30 holds 100 and key 60 holds 99
+    assert(best.range_aggregate(1, 101)==100);
+    best.Delete(30);
+    assert(best.range_aggregate(1, 101)==99);
+    assert(best.range_aggregate(1, 60) < 99 && best.range_aggregate(60, 61)==99);
+    assert(best.range_aggregate(50, 50)==MaxAugment::identity());
+
+    roster_metrics roster;
+    for (int player = 1; player <= 40; ++player) {
+        roster.record(1, player, player);
+        roster.record(2, player, 2 * player);
+    }
+    roster.clear(1, 20);
+    assert(roster.game_points(1, 10, 30)==(10 + 30) * 21 / 2 - 20);
+    assert(roster.game_points(2, 1, 40)==40 * 41);
+    assert(roster.game_points(3, 1, 40)==0);
+    // jersey INT_MAX counts at the top of the range, negative or not
+    roster.record(5, 1, 3);
+    roster.record(5, INT_MAX, -7);
+    assert(roster.game_points(5, 1, INT_MAX)==-4);
+    roster.record(5, INT_MAX, -1);
+    assert(roster.game_points(5, INT_MIN, INT_MAX)==2);
+
+    // game 1 scores 1..40 without 20, game 2 scores 2, 4, ..., 80
+    assert(roster.count_performances(20, 40)==20 + 11);
+    assert(roster.count_performances(81, 100)==0);
+
+    std::cout << "Range aggregate test succeeded!" << std::endl;
+}
+
+void testDeferredReclaim() {
+    reclaimer deferred;
+    {
+        roster_metrics roster;
+        roster.set_reclaimer(&deferred);
+        for (int game = 1; game <= 50; ++game) {
+            for (int player = 1; player <= 30; ++player) {
+                roster.record(game, player, game + player);
+            }
+        }
+        assert(roster.finish_game(7));
+        assert(roster.drop_game(7) && !roster.drop_game(7));
+        assert(roster.points(7, 1)==-1 && roster.game_points(7, 1, 30)==0);
+        assert(roster.ranked_receiver(1)==30 && roster.ranked_receiver(1471)==-1);
+        assert(roster.season_points(1)==(51 * 50 / 2 - 7) + 49);
+        roster.record(7, 2, 100);
+        assert(roster.ranked_receiver(1)==2 && roster.points(7, 2)==100);
+    }   // teardown only queues work
+    deferred.drain();
+
+    // trees hand their slabs over directly too
+    AVL_Tree<int, int> tree;
+    for (int i = 0; i < 10000; ++i) {
+        tree.Insert(i, i);
+    }
+    tree.Clear(deferred);
+    assert(tree.Size()==0 && tree.search(5)==nullptr);
+    tree.Insert(1, 1);
+    assert(tree.Size()==1);
+    deferred.drain();
+
+    std::cout << "Deferred reclaim test succeeded!" << std::endl;
+}
+
+void testInsertHint() {
+    AVL_Tree<int, int> tree;
+    for (int i = 0; i < 1000; i += 2) {
+        tree.insert_hint(tree.end(), i, i);   // appends
+    }
+    assert(tree.Size()==500 && tree.findMax()->key==998);
+
+    // a right hint inserts in place, a wrong one still lands in order
+    tree.insert_hint(tree.find(500), 499, 0);
+    tree.insert_hint(tree.begin(), 777, 0);
+    assert(tree.Size()==502 && tree.rank_of(499)==251 && tree.rank_of(777)==391);
+    tree.Delete(998);
+    assert(tree.findMax()->key==996);
+    tree.Insert(2000, 0);
+    assert(tree.findMax()->key==2000 && tree.select(502)->key==2000);
+
+    std::cout << "Insert hint test succeeded!" << std::endl;
+}
+
+void testGameDirectory() {
+    game_directory directory;
+    for (int game = 0; game < 1000; ++game) {
+        directory.insert(game * 7, game);
+    }
+    assert(directory.size()==1000 && directory.find(693)==99 && directory.find(5)==-1);
+    for (int game = 0; game < 1000; game += 2) {
+        assert(directory.erase(game * 7));
+    }
+    assert(!directory.erase(0) && directory.find(0)==-1 && directory.find(7)==1);
+    directory.insert(0, 5000);
+    assert(directory.size()==501 && directory.find(0)==5000);
+
+    // the directory follows games in and out of a roster
+    roster_metrics roster;
+    roster.record(3, 1, 10);
+    roster.record(4, 1, 20);
+    assert(roster.points(3, 1)==10 && roster.points(4, 1)==20);
+    assert(roster.drop_game(4) && roster.points(4, 1)==-1);
+    roster.record(4, 2, 5);
+    assert(roster.points(4, 2)==5 && roster.points(4, 1)==-1);
+
+    std::cout << "Game directory test succeeded!" << std::endl;
+}
+
+void testRankedReceivers() {
+    roster_metrics roster;
+    for (int player = 1; player <= 300; ++player) {
+        roster.record(player % 7, player, player * 3 % 1000);
+    }
+    // dense ascending, scattered, descending and out of range ranks
+    std::vector<int> ranks;
+    for (int rank = 1; rank <= 300; ++rank) {
+        ranks.push_back(rank);
+    }
+    int extra[] = {0, 301, -5, 150, 2, 299, 40, 40, 41, 290, 1};
+    ranks.insert(ranks.end(), extra, extra + 11);
+    std::vector<int> out(ranks.size());
+    roster.ranked_receivers(ranks, out);
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        assert(out[i]==roster.ranked_receiver(ranks[i]));
+    }
+    assert(out[300]==-1 && out[301]==-1 && out[302]==-1);
+
+    std::cout << "Ranked receivers test succeeded!" << std::endl;
+}
+
+void testLoadRecords() {
+    const char* feed = "roster_test.records";
+    FILE* out = fopen(feed, "w");
+    unsigned seed = 7;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int game = (seed >> 8) % 97, player = (seed >> 16) % 40 + 1;
+        if ((seed >> 4) % 5 == 0) {
+            fprintf(out, "clear %d %d\n", game + 1000, player);
+        } else {
+            fprintf(out, "record %d %d %d\n", game, player, (seed >> 20) % 60);
+        }
+        if (i % 3 == 0) {
+            fprintf(out, "clear %d %d\n", game, player);
+        }
+    }
+    fprintf(out, "junk\nrecord 500 1 7");   // no final newline
+    fclose(out);
+
+    // loading in parallel ends where applying in order does
+    roster_metrics serial, loaded;
+    FILE* in = fopen(feed, "r");
+    ingest_stream(in, serial, nullptr);
+    fclose(in);
+    loaded.record(1, 1, 1000);   // replaced by the load
+    assert(loaded.load_records(feed, 4));
+    assert(loaded.points(500, 1)==7 && loaded.points(1000, 1)==-1);
+    for (int game = 0; game < 97; ++game) {
+        for (int player = 1; player <= 40; ++player) {
+            assert(loaded.points(game, player)==serial.points(game, player));
+        }
+        assert(loaded.top_k_in_game(game, 40)==serial.top_k_in_game(game, 40));
+    }
+    for (int rank = 1; rank <= 4000; ++rank) {
+        assert(loaded.ranked_receiver(rank)==serial.ranked_receiver(rank));
+    }
+    for (int rank = 1; rank <= 41; ++rank) {
+        assert(loaded.ranked_season_receiver(rank)==serial.ranked_season_receiver(rank));
+    }
+    roster_stats a = loaded.stats(), b = serial.stats();
+    assert(a.gameCount==b.gameCount && a.performances.nodes==b.performances.nodes &&
+           a.season.nodes==b.season.nodes && a.games.nodes==b.games.nodes);
+    assert(!loaded.load_records("no/such/file"));
+    remove(feed);
+
+    std::cout << "Load records test succeeded!" << std::endl;
+}
+
+void testBPlusTree() {
+    // the same operations on both trees give the same answers
+    BPlusTree<int, int> fat;
+    AVL_Tree<int, int> avl;
+    unsigned seed = 11;
+    for (int i = 0; i < 60000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int key = (seed >> 8) % 5000 - 1000;
+        if ((seed >> 4) % 3 != 0) {
+            if (avl.search(key) == nullptr) {
+                avl.Insert(key, i);
+                fat.Insert(key, i);
+            }
+        } else {
+            avl.Delete(key);
+            fat.Delete(key);
+        }
+        assert(fat.Size()==avl.Size());
+        assert(fat.count_less(key)==avl.count_less(key) && fat.rank_of(key)==avl.rank_of(key));
+        AVL_Tree<int, int>::Node* p = avl.Predecessor(key);
+        BPlusTree<int, int>::Node* q = fat.Predecessor(key);
+        assert((p == nullptr) == (q == nullptr) && (p == nullptr || p->key==q->key));
+        p = avl.Successor(key);
+        q = fat.Successor(key);
+        assert((p == nullptr) == (q == nullptr) && (p == nullptr || p->key==q->key));
+    }
+    AVL_Tree<int, int>::iterator a = avl.begin();
+    int rank = 1;
+    for (BPlusTree<int, int>::iterator b = fat.begin(); b != fat.end(); ++b, ++a, ++rank) {
+        assert(b->key==a->key && b->secondValue==a->secondValue);
+        assert(fat.select(rank)->key==a->key);
+    }
+    assert(a==avl.end() && --fat.end()==fat.find(avl.findMax()->key));
+
+    // bulk build and collect round-trip; deleting everything empties it
+    std::vector<std::pair<int, int> > items;
+    avl.collect_sorted(items);
+    fat.build_from_sorted(items);
+    std::vector<std::pair<int, int> > back;
+    fat.collect_sorted(back);
+    assert(back==items);
+    for (size_t i = 0; i < items.size(); i += 2) {
+        fat.Delete(items[i].first);
+    }
+    for (size_t i = 1; i < items.size(); i += 2) {
+        assert(fat.rank_of(items[i].first)==1 && fat.count_less(items[i].first)==0);
+        fat.Delete(items[i].first);
+    }
+    assert(fat.Size()==0 && fat.begin()==fat.end() && fat.findMax()==nullptr);
+
+    std::cout << "B+ tree test succeeded!" << std::endl;
+}
+
+void testLazyClear() {
+    // a roster that tombstones clears answers like one that deletes
+    roster_metrics eager, lazy;
+    lazy.set_lazy_clear(true, 0.5);
+    unsigned seed = 5;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int game = (seed >> 8) % 40, player = (seed >> 16) % 30 + 1;
+        int points = (seed >> 20) % 25;   // re-records often repeat a performance
+        switch ((seed >> 4) % 10) {
+        case 0:
+        case 1:
+        case 2:
+            eager.clear(game, player);
+            lazy.clear(game, player);
+            break;
+        case 3:
+            if (i % 7 == 0) {
+                assert(eager.drop_game(game)==lazy.drop_game(game));
+            }
+            break;
+        default:
+            eager.record(game, player, points);
+            lazy.record(game, player, points);
+        }
+        if (i % 97 == 0) {
+            int rank = (seed >> 12) % 1300 + 1;
+            assert(eager.ranked_receiver(rank)==lazy.ranked_receiver(rank));
+            assert(eager.count_performances(5, 15)==lazy.count_performances(5, 15));
+            assert(eager.count_performances(0, INT_MAX)==lazy.count_performances(0, INT_MAX));
+            assert(eager.ranked_range(rank, rank + 20)==lazy.ranked_range(rank, rank + 20));
+            // purging keeps tombstones near half the index, with no rebuild
+            assert(lazy.performances().Size() <= 2 * eager.performances().Size() + 16);
+        }
+    }
+    assert(eager.top_k(2000)==lazy.top_k(2000));
+    int ranks[] = {1, 2, 3, 50, 51, 900, 0, 5000};
+    int a[8], b[8];
+    eager.ranked_receivers(ranks, a);
+    lazy.ranked_receivers(ranks, b);
+    assert(std::equal(a, a + 8, b));
+
+    // snapshots and batches never see a tombstone
+    for (int player = 1; player <= 10; ++player) {
+        lazy.clear(3, player);
+        eager.clear(3, player);
+    }
+    lazy.enable_snapshots();
+    assert(lazy.save_snapshot("roster_lazy.snap"));
+    roster_metrics restored;
+    assert(restored.load_snapshot("roster_lazy.snap"));
+    assert(restored.top_k(2000)==eager.top_k(2000));
+    remove("roster_lazy.snap");
+    std::vector<Record> batch;
+    for (int player = 1; player <= 10; ++player) {
+        Record r = {3, player, 7};
+        batch.push_back(r);
+    }
+    lazy.record_batch(batch);
+    eager.record_batch(batch);
+    assert(lazy.top_k(2000)==eager.top_k(2000));
+
+    // turning it off compacts; the index then matches the eager one
+    lazy.clear(3, 1);
+    eager.clear(3, 1);
+    lazy.set_lazy_clear(false);
+    assert(lazy.performances().Size()==eager.performances().Size());
+    assert(lazy.top_k(2000)==eager.top_k(2000));
+
+    std::cout << "Lazy clear test succeeded!" << std::endl;
+}
+
+// game g's jerseys best first, from points(): the slow answer
+static std::vector<int> gameLeaders(const roster_metrics& roster, int game) {
+    std::vector<std::pair<int, int> > played;
+    for (int player = 1; player <= 30; ++player) {
+        if (roster.points(game, player) >= 0) {
+            played.push_back(std::make_pair(-roster.points(game, player), -player));
+        }
+    }
+    std::sort(played.begin(), played.end());
+    std::vector<int> leaders;
+    for (size_t i = 0; i < played.size(); ++i) {
+        leaders.push_back(-played[i].second);
+    }
+    return leaders;
+}
+
+void testRankedInGame() {
+    roster_metrics roster;
+    roster.record(1, 1, 10);
+    roster.record(1, 2, 30);
+    roster.record(1, 3, 20);
+    roster.record(2, 4, 50);
+    assert(roster.ranked_receiver_in_game(1, 1)==2 && roster.ranked_receiver_in_game(1, 3)==1);
+    assert(roster.ranked_receiver_in_game(1, 4)==-1 && roster.ranked_receiver_in_game(1, 0)==-1);
+    assert(roster.ranked_receiver_in_game(9, 1)==-1 && roster.top_k_in_game(9, 3).empty());
+    assert(roster.top_k_in_game(1, 2)==std::vector<int>({2, 3}));
+    roster.record(1, 2, 5);   // replaces 30
+    roster.clear(1, 3);
+    assert(roster.top_k_in_game(1, 5)==std::vector<int>({1, 2}));
+
+    // every way in keeps the rankings in step with the rosters
+    unsigned seed = 3;
+    std::vector<Record> batch;
+    for (int i = 0; i < 6000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int game = (seed >> 8) % 12, player = (seed >> 16) % 30 + 1, points = (seed >> 20) % 40;
+        switch ((seed >> 4) % 8) {
+        case 0:
+            roster.clear(game, player);
+            break;
+        case 1:
+            if (i % 50 == 0) {
+                roster.drop_game(game);
+            }
+            break;
+        case 2: {
+            Record r = {game, player, points};
+            batch.push_back(r);
+            if (batch.size() == 40) {
+                roster.record_batch(batch);
+                batch.clear();
+            }
+            break;
+        }
+        default:
+            roster.record(game, player, points);
+        }
+    }
+    assert(roster.save_snapshot("roster_ranked.snap"));
+    roster_metrics restored;
+    assert(restored.load_snapshot("roster_ranked.snap"));
+    remove("roster_ranked.snap");
+    for (int game = 0; game < 12; ++game) {
+        std::vector<int> leaders = gameLeaders(roster, game);
+        assert(roster.top_k_in_game(game, 30)==leaders && restored.top_k_in_game(game, 30)==leaders);
+        assert(roster.top_k_in_game(game, 3)==std::vector<int>(leaders.begin(), leaders.begin() + std::min<size_t>(3, leaders.size())));
+        for (size_t k = 0; k < leaders.size(); ++k) {
+            assert(roster.ranked_receiver_in_game(game, k + 1)==leaders[k]);
+        }
+    }
+
+    std::cout << "Ranked in game test succeeded!" << std::endl;
+}
+
+void testLeaderboardCache() {
+    // cached ranks agree with the tree through every kind of update
+    roster_metrics roster, plain;
+    unsigned seed = 17;
+    uint64_t version = roster.leaderboard_version();
+    std::vector<Record> batch;
+    for (int i = 0; i < 8000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        int game = (seed >> 8) % 20, player = (seed >> 16) % 25 + 1, points = (seed >> 20) % 300;
+        switch ((seed >> 4) % 9) {
+        case 0:
+        case 1:
+            roster.clear(game, player);
+            plain.clear(game, player);
+            break;
+        case 2:
+            if (i % 40 == 0) {
+                roster.drop_game(game);
+                plain.drop_game(game);
+            }
+            break;
+        case 3: {
+            Record r = {game, player, points};
+            batch.push_back(r);
+            if (batch.size() == 30) {
+                roster.record_batch(batch);
+                plain.record_batch(batch);
+                batch.clear();
+            }
+            break;
+        }
+        default:
+            roster.record(game, player, points);
+            plain.record(game, player, points);
+        }
+        if (i == 4000) {
+            roster.set_lazy_clear(true, 0.5);
+        }
+        // the tree answers past the cache; ranked_range there too
+        std::vector<int> top = roster.top_k(25);
+        assert(top==plain.ranked_range(1, 25) && roster.top_k(60)==plain.ranked_range(1, 60));
+        for (int rank = 1; rank <= 33; rank += 4) {
+            assert(roster.ranked_receiver(rank)==(rank <= (int)top.size() ? top[rank - 1] : plain.ranked_receiver(rank)));
+        }
+    }
+
+    // a change below the boundary leaves the version alone
+    roster_metrics small;
+    for (int player = 1; player <= 40; ++player) {
+        small.record(1, player, 1000 + player);
+    }
+    version = small.leaderboard_version();
+    small.record(2, 1, 5);
+    small.clear(2, 1);
+    assert(small.leaderboard_version()==version);
+    small.record(2, 1, 5000);
+    assert(small.leaderboard_version()!=version && small.ranked_receiver(1)==1);
+    small.clear(1, 40);
+    assert(small.ranked_receiver(2)==39 && small.ranked_receiver(32)==9);
+    assert(small.save_snapshot("roster_top.snap") && small.load_snapshot("roster_top.snap"));
+    remove("roster_top.snap");
+    assert(small.ranked_receiver(1)==1 && small.ranked_receiver(32)==9);
+
+    std::cout << "Leaderboard cache test succeeded!" << std::endl;
+}
+
 int main() {
     test();
+    testBatch();
+    testSeasonTotals();
+    testSnapshots();
+    testConcurrent();
+    testSnapshotFile();
+    testEventLog();
+    testStats();
+    testFrozen();
+    testRangeAggregate();
+    testDeferredReclaim();
+    testInsertHint();
+    testGameDirectory();
+    testRankedReceivers();
+    testLoadRecords();
+    testBPlusTree();
+    testLazyClear();
+    testRankedInGame();
+    testLeaderboardCache();
 
     return 0;
 }
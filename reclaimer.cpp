@@ -0,0 +1,84 @@
+#include "reclaimer.h"
+using namespace std;
+
+reclaimer::reclaimer() {
+    working = false;
+    stopping = false;
+    worker = thread(&reclaimer::run, this);
+}
+
+reclaimer::~reclaimer() {
+    {
+        unique_lock<mutex> guard(lock);
+        submitLocked();
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+// move the current batch to the worker's queue (lock held)
+void reclaimer::submitLocked() {
+    if (!filling.empty()) {
+        ready.push_back(move(filling));
+        filling.clear();
+        filling.reserve(BATCH);
+    }
+}
+
+// worker loop: run one batch at a time outside the lock
+void reclaimer::run() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+        wake.wait(guard, [this]() { return stopping || !ready.empty(); });
+        if (ready.empty()) {
+            return; // stopping with nothing left
+        }
+        vector<function<void()> > batch = move(ready.front());
+        ready.erase(ready.begin());
+        working = true;
+        guard.unlock();
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i]();
+        }
+        batch.clear();
+        guard.lock();
+        working = false;
+        if (ready.empty()) {
+            idle.notify_all();
+        }
+    }
+}
+
+//defer(task) | run task on the reclaimer thread, some time later
+void reclaimer::defer(function<void()> task) {
+    bool full;
+    {
+        unique_lock<mutex> guard(lock);
+        filling.push_back(move(task));
+        full = filling.size() >= BATCH;
+        if (full) {
+            submitLocked();
+        }
+    }
+    if (full) {
+        wake.notify_one();
+    }
+}
+
+//flush() | hand the current partial batch to the worker now
+void reclaimer::flush() {
+    {
+        unique_lock<mutex> guard(lock);
+        submitLocked();
+    }
+    wake.notify_one();
+}
+
+//drain() | flush and wait until everything retired so far is freed
+void reclaimer::drain() {
+    unique_lock<mutex> guard(lock);
+    submitLocked();
+    wake.notify_one();
+    idle.wait(guard, [this]() { return ready.empty() && !working; });
+}
@@ -0,0 +1,52 @@
+#ifndef RECLAIMER_H
+#define RECLAIMER_H
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Frees memory on a background thread so the caller never pays for a
+// large teardown. retire() and defer() only append to the current
+// batch, O(1) and without waking anyone; a full batch (or flush()) is
+// handed to the worker in one step. Objects handed over must no longer
+// be reachable by the caller. The reclaimer must outlive everything
+// that retires into it; its destructor runs whatever is still queued.
+class reclaimer {
+    private:
+        static const size_t BATCH = 64;
+
+        mutex lock;
+        condition_variable wake;      // worker: a batch is ready
+        condition_variable idle;      // drain(): queue emptied
+        vector<function<void()> > filling;           // current batch
+        vector<vector<function<void()> > > ready;    // handed off
+        bool working;
+        bool stopping;
+        thread worker;
+
+        void run();
+        void submitLocked();
+    public:
+        // constructor
+        reclaimer();
+        ~reclaimer();
+        reclaimer(const reclaimer&) = delete;
+        reclaimer& operator=(const reclaimer&) = delete;
+
+        void defer(function<void()> task);
+        void flush();
+        void drain();
+
+        template <class T>
+        void retire(T* object) {
+            defer([object]() { delete object; });
+        }
+        template <class T>
+        void retire_array(T* objects) {
+            defer([objects]() { delete [] objects; });
+        }
+};
+
+#endif
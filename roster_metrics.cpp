@@ -1,9 +1,122 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "event_log.h"
 #include "roster_metrics.h"
+#include "roster_snapshot.h"
+#include "work_pool.h"
 using namespace std;
 
+// add sorted, not-yet-present items to tree. When the batch is large
+// next to the tree, merge with the existing contents and rebuild in
+// O(n + m); otherwise m single inserts are cheaper.
+template <class Tree, class Key, class Value>
+static void mergeBatch(Tree& tree, const vector<pair<Key, Value> >& added) {
+    size_t existing = tree.Size();
+    size_t total = existing + added.size();
+    if (added.size() * log2(total + 1) < total) {
+        for (size_t i = 0; i < added.size(); ++i) {
+            tree.Insert(added[i].first, added[i].second);
+        }
+        return;
+    }
+    vector<pair<Key, Value> > current, merged;
+    tree.collect_sorted(current);
+    merged.reserve(total);
+    merge(current.begin(), current.end(), added.begin(), added.end(),
+          back_inserter(merged),
+          [](const pair<Key, Value>& a, const pair<Key, Value>& b) { return a.first < b.first; });
+    tree.build_from_sorted(merged);
+}
+
+// a game's ranking from its (jersey, points) pairs
+static GameRankTree* rankGame(const vector<pair<int, int> >& players) {
+    vector<pair<pair<int, int>, int> > ranks;
+    ranks.reserve(players.size());
+    for (size_t i = 0; i < players.size(); ++i) {
+        ranks.push_back(make_pair(make_pair(players[i].second, players[i].first), players[i].first));
+    }
+    sort(ranks.begin(), ranks.end());
+    GameRankTree* ranking = new GameRankTree();
+    ranking->build_from_sorted(ranks);
+    return ranking;
+}
+
 roster_metrics::roster_metrics() {
-    gameTree = AVL_Tree();
-    performanceTree = AVL_Tree();
+    snapshotsEnabled = false;
+    deferred = nullptr;
+    lastGame = 0;
+    lastSlot = -1;
+    lazyClear = false;
+    compactRatio = 0.25;
+    deadPerformances = 0;
+    topCount = 0;
+    topVersion = 0;
+}
+
+// every tree frees its own node slabs; only the per-game trees
+// need to be deleted here. With a reclaimer set, all of it is handed
+// over instead: the game trees in one task and the member trees a
+// slab at a time.
+roster_metrics::~roster_metrics() {
+    if (deferred != nullptr) {
+        vector<PlayerTree*> rosters(move(gameRosters));
+        vector<GameRankTree*> rankings(move(gameRankings));
+        vector<FrozenPlayerTree*> frozen(move(frozenRosters));
+        deferred->defer([rosters, rankings, frozen]() {
+            for (size_t i = 0; i < rosters.size(); ++i) {
+                delete rosters[i];
+                delete rankings[i];
+            }
+            for (size_t i = 0; i < frozen.size(); ++i) {
+                delete frozen[i];
+            }
+        });
+        performanceTree.Clear(*deferred);
+        gameTree.Clear(*deferred);
+        seasonTotals.Clear(*deferred);
+        seasonRanking.Clear(*deferred);
+        deferred->flush();
+        return;
+    }
+    for (size_t i = 0; i < gameRosters.size(); ++i) {
+        delete gameRosters[i];
+        delete gameRankings[i];
+    }
+    for (size_t i = 0; i < frozenRosters.size(); ++i) {
+        delete frozenRosters[i];
+    }
+}
+
+//set_reclaimer(r) | free dropped games and this roster's trees on r's
+//thread from now on (nullptr: free them inline). r must outlive the
+//roster.
+void roster_metrics::set_reclaimer(reclaimer* r) {
+    deferred = r;
+}
+
+//set_lazy_clear(on, ratio) | with on, clear() and drop_game() leave a
+//tombstone in the performance index instead of deleting and
+//rebalancing, and rank queries skip tombstones by per-subtree live
+//counts. Once tombstones pass ratio of the index, each clear also
+//deletes up to PURGE_STEP of them for real, so they shrink back
+//without any one call paying for a rebuild. Turning it off compacts
+//at once. The B+-tree build keeps clear()
+//eager: its deletes only shift entries within a leaf.
+void roster_metrics::set_lazy_clear(bool on, double ratio) {
+#ifndef ROSTER_BPLUS
+    lazyClear = on;
+    compactRatio = ratio;
+#else
+    (void)on;
+    (void)ratio;
+#endif
+    if (!lazyClear && deadPerformances > 0) {
+        compactPerformances();
+    }
 }
 
 // mutator functions
@@ -13,92 +126,1133 @@ void roster_metrics::record(int game, int player, int points) {
     //record tree by game
     
     //check if game exists
-    AVLTreeNode* gameNode = gameTree.search(game);
-    if (gameNode == nullptr) {
+    int slot = findGame(game);
+    if (slot < 0) {
         // If the game node doesn't exist, create a new one
-        gameNode = new AVLTreeNode();
-        gameNode->key = game;
-        gameNode->secondValue = 0;
-        gameNode->left = nullptr;
-        gameNode->right = nullptr;
-        gameNode->parent = nullptr;
-        gameNode->balanceFactor = '=';
-        gameNode->nextTree = new AVL_Tree(); //avl tree for players/jerseys this game
-        gameTree.Insert(gameNode);
-    }
-
-    //record tree by jersey
-    AVLTreeNode *playerNode = new AVLTreeNode();
-    playerNode->key = player;
-    playerNode->secondValue = points;
-    playerNode->left = nullptr;
-    playerNode->right = nullptr;
-    playerNode->parent = nullptr;
-    playerNode->balanceFactor = '=';
-    gameNode->nextTree->Insert(playerNode);
-
-    //record tree by performance
-    AVLTreeNode *performanceNode = new AVLTreeNode();
-    performanceNode->key = points;
-    performanceNode->secondValue = player;
-    performanceNode->left = nullptr;
-    performanceNode->right = nullptr;
-    performanceNode->parent = nullptr;
-    performanceTree.Insert(performanceNode);
+        slot = gameRosters.size();
+        gameTree.Insert(game, slot);
+        gameDirectory.insert(game, slot);
+        gameRosters.push_back(new PlayerTree()); //avl tree for players/jerseys this game
+        gameRankings.push_back(new GameRankTree());
+        lastGame = game;
+        lastSlot = slot;
+    }
+    PlayerTree* players = gameRosters[slot];
+    thaw(slot);
+
+    //a second record for the same jersey and game replaces the first
+    if (players->search(player) != nullptr) {
+        clear(game, player);
+    }
+
+    //record tree by jersey, and the game's ranking
+    players->Insert(player, points);
+    gameRankings[slot]->Insert(make_pair(points, player), player);
+    adjustSeason(player, points, 1);
+
+    //record tree by performance; a lazily cleared copy of this exact
+    //performance is brought back instead of inserted beside it
+    Performance p(points, player, game);
+    if (deadPerformances > 0 && performanceTree.update(p, player)) {
+        deadPerformances--;
+    } else {
+        performanceTree.Insert(p, player);
+    }
+    enterTop(p);
+    if (snapshotsEnabled) {
+        publishedPerformance.Insert(Performance(points, player, game), player);
+    }
 
 }
 
+//record_batch(records) | record(g, r, p) for every record at once
+//sorts the batch once and builds each touched tree bottom-up instead
+//of paying an Insert + restoreAVL per record per index. Later records
+//for the same game and jersey win, as with repeated record() calls.
+void roster_metrics::record_batch(span<const Record> records) {
+    vector<Record> batch(records.begin(), records.end());
+    stable_sort(batch.begin(), batch.end(), [](const Record& a, const Record& b) {
+        return a.game != b.game ? a.game < b.game : a.player < b.player;
+    });
+
+    vector<pair<int, int> > newGames;
+    vector<pair<Performance, int> > newPerformances;
+    vector<pair<int, int> > newPlayers;
+    vector<pair<pair<int, int>, int> > newRanks;
+    // the snapshot mirror takes the whole batch as one version at the
+    // end, so clear() must not publish its part on the way
+    vector<Performance> replaced;
+    bool publish = snapshotsEnabled;
+    snapshotsEnabled = false;
+    for (size_t start = 0; start < batch.size(); ) {
+        int game = batch[start].game;
+        size_t end = start;
+        while (end < batch.size() && batch[end].game == game) {
+            ++end;
+        }
+
+        PlayerTree* players = nullptr;
+        GameRankTree* ranking = nullptr;
+        int slot = findGame(game);
+        if (slot >= 0) {
+            players = gameRosters[slot];
+            ranking = gameRankings[slot];
+            thaw(slot);
+        } else {
+            newGames.push_back(make_pair(game, (int)gameRosters.size()));
+            gameDirectory.insert(game, gameRosters.size());
+            players = new PlayerTree();
+            ranking = new GameRankTree();
+            gameRosters.push_back(players);
+            gameRankings.push_back(ranking);
+        }
+
+        // keep the last record for each jersey, replacing older points
+        newPlayers.clear();
+        newRanks.clear();
+        for (size_t i = start; i < end; ++i) {
+            if (i + 1 < end && batch[i + 1].player == batch[i].player) {
+                continue;
+            }
+            const Record& r = batch[i];
+            PlayerTree::Node* old = (slot >= 0) ? players->search(r.player) : nullptr;
+            if (old != nullptr) {
+                replaced.push_back(Performance(old->secondValue, r.player, game));
+                clear(game, r.player);
+            }
+            newPlayers.push_back(make_pair(r.player, r.points));
+            newRanks.push_back(make_pair(make_pair(r.points, r.player), r.player));
+            adjustSeason(r.player, r.points, 1);
+            newPerformances.push_back(make_pair(Performance(r.points, r.player, game), r.player));
+        }
+        mergeBatch(*players, newPlayers);
+        sort(newRanks.begin(), newRanks.end());
+        mergeBatch(*ranking, newRanks);
+        start = end;
+    }
+
+    // games arrive sorted from the batch order
+    mergeBatch(gameTree, newGames);
+    sort(newPerformances.begin(), newPerformances.end(),
+         [](const pair<Performance, int>& a, const pair<Performance, int>& b) { return a.first < b.first; });
+    if (deadPerformances > 0) {
+        // mergeBatch may not meet a tombstone of a performance it adds,
+        // so those are revived in place, as record() does
+        vector<pair<Performance, int> > added;
+        added.reserve(newPerformances.size());
+        for (size_t i = 0; i < newPerformances.size(); ++i) {
+            if (deadPerformances > 0 && performanceTree.update(newPerformances[i].first, newPerformances[i].second)) {
+                deadPerformances--;
+            } else {
+                added.push_back(newPerformances[i]);
+            }
+        }
+        mergeBatch(performanceTree, added);
+    } else {
+        mergeBatch(performanceTree, newPerformances);
+    }
+    refreshTop();
+    snapshotsEnabled = publish;
+    if (snapshotsEnabled) {
+        // path-copy a small batch into the mirror; rebuild it for a
+        // large one, as mergeBatch does for the index
+        size_t changes = replaced.size() + newPerformances.size();
+        size_t total = performanceTree.Size();
+        if (changes * log2(total + 1) < total) {
+            publishedPerformance.Batch(replaced, newPerformances);
+        } else {
+            republish();
+        }
+    }
+}
+
 //clear(g, r) | remove any record that jersey r played in game g
 void roster_metrics::clear(int game, int player) {
     //find game node g in game tree
     //go to player tree
-    //ClearTree (AVLTreeNode *n)
-    AVLTreeNode *gameNode = gameTree.search(game);
-    if (gameNode != nullptr) {
+    int slot = findGame(game);
+    if (slot >= 0) {
+        PlayerTree* players = gameRosters[slot];
         
         //delete player from game if player exists and played
-        AVLTreeNode *playerNode = gameNode->nextTree->search(player);
-        if (playerNode != nullptr) {
-            gameNode->nextTree->Delete(player);
+        PlayerTree::Node *playerNode = players->search(player);
+        if (playerNode == nullptr) {
+            return;
         }
+        int points = playerNode->secondValue; // playerNode is freed by Delete
+        thaw(slot);
+        players->Delete(player);
+        gameRankings[slot]->Delete(make_pair(points, player));
+        adjustSeason(player, -points, -1);
     
-        //delete points from that game from performance tree
-        AVLTreeNode *performanceNode = performanceTree.search(playerNode->secondValue);
-        if (performanceNode != nullptr) {
+        //delete exactly this game's entry from the performance tree;
+        //the composite key tells it apart from equal point totals
+        retirePerformance(Performance(points, player, game));
+        leaveTop(Performance(points, player, game));
+        if (snapshotsEnabled) {
+            publishedPerformance.Delete(Performance(points, player, game));
+        }
+    }
+}
+
+// add points (and games records) to player's season total, moving
+// the player within the ranking in O(log n)
+void roster_metrics::adjustSeason(int player, int points, int games) {
+    SeasonTree::Node* total = seasonTotals.search(player);
+    if (total == nullptr) {
+        SeasonTotal start = {points, games};
+        seasonTotals.Insert(player, start);
+        seasonRanking.Insert(make_pair(points, player), player);
+        return;
+    }
+    seasonRanking.Delete(make_pair(total->secondValue.points, player));
+    total->secondValue.points += points;
+    total->secondValue.games += games;
+    if (total->secondValue.games == 0) {
+        seasonTotals.Delete(player);
+    } else {
+        seasonRanking.Insert(make_pair(total->secondValue.points, player), player);
+    }
+}
+
+// recompute both season indexes from the game rosters
+void roster_metrics::rebuildSeason() {
+    vector<pair<int, int> > played;
+    for (size_t i = 0; i < gameRosters.size(); ++i) {
+        gameRosters[i]->collect_sorted(played);
+    }
+    sort(played.begin(), played.end());
+
+    vector<pair<int, SeasonTotal> > totals;
+    for (size_t i = 0; i < played.size(); ++i) {
+        if (totals.empty() || totals.back().first != played[i].first) {
+            SeasonTotal start = {0, 0};
+            totals.push_back(make_pair(played[i].first, start));
+        }
+        totals.back().second.points += played[i].second;
+        totals.back().second.games++;
+    }
+    vector<pair<pair<int, int>, int> > ranking;
+    ranking.reserve(totals.size());
+    for (size_t i = 0; i < totals.size(); ++i) {
+        ranking.push_back(make_pair(make_pair(totals[i].second.points, totals[i].first), totals[i].first));
+    }
+    sort(ranking.begin(), ranking.end());
+    seasonTotals.build_from_sorted(totals);
+    seasonRanking.build_from_sorted(ranking);
+}
+
+//finish_game(g) | mark game g read-only for now: its roster is frozen
+//into a contiguous layout that points() searches instead of the tree.
+//A later record or clear for g thaws it again. Returns false if g
+//has no records.
+bool roster_metrics::finish_game(int game) {
+    int slot = findGame(game);
+    if (slot < 0) {
+        return false;
+    }
+    if (frozenRosters.size() < gameRosters.size()) {
+        frozenRosters.resize(gameRosters.size(), nullptr);
+    }
+    if (frozenRosters[slot] == nullptr) {
+        frozenRosters[slot] = new FrozenPlayerTree(gameRosters[slot]->freeze());
+    }
+    return true;
+}
+
+//drop_game(g) | remove every record of game g. The game's entries
+//leave the performance and season indexes one by one, but its player
+//tree is detached whole and, with a reclaimer set, freed off-thread.
+//Returns false if g has no records.
+bool roster_metrics::drop_game(int game) {
+    int slot = findGame(game);
+    if (slot < 0) {
+        return false;
+    }
+    PlayerTree* players = gameRosters[slot];
+    for (PlayerTree::iterator r = players->begin(); r != players->end(); ++r) {
+        Performance p(r->secondValue, r->key, game);
+        retirePerformance(p);
+        if (snapshotsEnabled) {
+            publishedPerformance.Delete(p);
+        }
+        adjustSeason(r->key, -r->secondValue, -1);
+    }
+    thaw(slot);
+    gameTree.Delete(game);
+    gameDirectory.erase(game);
+    lastSlot = -1;
+    refreshTop();
+
+    // the slot is not reused; an empty tree keeps loops over
+    // gameRosters simple
+    GameRankTree* ranking = gameRankings[slot];
+    gameRosters[slot] = new PlayerTree();
+    gameRankings[slot] = new GameRankTree();
+    if (deferred != nullptr) {
+        deferred->retire(players);
+        deferred->retire(ranking);
+    } else {
+        delete players;
+        delete ranking;
+    }
+    return true;
+}
+
+// slot of game g in gameRosters, or -1. Record and clear usually
+// repeat the same game, so the last hit is checked before the hash.
+int roster_metrics::findGame(int game) {
+    if (lastSlot >= 0 && lastGame == game) {
+        return lastSlot;
+    }
+    int slot = gameDirectory.find(game);
+    if (slot >= 0) {
+        lastGame = game;
+        lastSlot = slot;
+    }
+    return slot;
+}
+
+// read-only lookups use the cache but never move it, so concurrent
+// readers do not write shared state
+int roster_metrics::findGame(int game) const {
+    if (lastSlot >= 0 && lastGame == game) {
+        return lastSlot;
+    }
+    return gameDirectory.find(game);
+}
+
+// delete every game roster and frozen copy ahead of a reload
+void roster_metrics::discardGames() {
+    for (size_t i = 0; i < gameRosters.size(); ++i) {
+        delete gameRosters[i];
+        delete gameRankings[i];
+    }
+    gameRosters.clear();
+    gameRankings.clear();
+    for (size_t i = 0; i < frozenRosters.size(); ++i) {
+        delete frozenRosters[i];
+    }
+    frozenRosters.clear();
+    gameDirectory.clear();
+    lastSlot = -1;
+    deadPerformances = 0;   // the performance index is rebuilt too
+    deadKeys.clear();
+    topCount = 0;
+}
 
+// take p out of the performance index: deleted, or under lazy clear
+// marked dead in place. Past the ratio (or with many revived keys
+// queued) a bounded purge runs, deleting more tombstones than this
+// call added.
+void roster_metrics::retirePerformance(const Performance& p) {
+    if (!lazyClear) {
+        performanceTree.Delete(p);
+        return;
+    }
+    if (performanceTree.update(p, CLEARED_JERSEY)) {
+        deadPerformances++;
+        deadKeys.push_back(p);
+    }
+    if (deadPerformances > compactRatio * performanceTree.Size() ||
+        deadKeys.size() > 2 * (size_t)deadPerformances + PURGE_STEP) {
+        purgeDead(PURGE_STEP);
+    }
+}
+
+// delete up to steps queued tombstones for real, O(steps log n);
+// keys record() has revived since are just dropped from the queue
+void roster_metrics::purgeDead(int steps) {
+    for (; steps > 0 && !deadKeys.empty(); --steps) {
+        Performance p = deadKeys.back();
+        deadKeys.pop_back();
+        PerformanceTree::Node* node = performanceTree.search(p);
+        if (node != nullptr && node->secondValue == CLEARED_JERSEY) {
+            performanceTree.Delete(p);
+            deadPerformances--;
+        }
+    }
+}
+
+// rebuild the performance index without its tombstones, for turning
+// lazy clear off; with a reclaimer set the old nodes are freed on its
+// thread
+void roster_metrics::compactPerformances() {
+    vector<pair<Performance, int> > all, live;
+    performanceTree.collect_sorted(all);
+    live.reserve(all.size() - deadPerformances);
+    for (size_t i = 0; i < all.size(); ++i) {
+        if (all[i].second != CLEARED_JERSEY) {
+            live.push_back(all[i]);
         }
+    }
+    if (deferred != nullptr) {
+        performanceTree.Clear(*deferred);
+    }
+    performanceTree.build_from_sorted(live);
+    deadPerformances = 0;
+    deadKeys.clear();
+}
 
+// performances in the index that are not tombstones
+int roster_metrics::livePerformances() const {
+#ifdef ROSTER_BPLUS
+    return performanceTree.Size();
+#else
+    return performanceTree.aggregate();
+#endif
+}
+
+// live performances less than p
+int roster_metrics::liveCountLess(const Performance& p) const {
+#ifdef ROSTER_BPLUS
+    return performanceTree.count_less(p);
+#else
+    return (deadPerformances == 0) ? performanceTree.count_less(p) : performanceTree.aggregate_less(p);
+#endif
+}
 
+// the rank-th smallest live performance (1-based), or end()
+PerformanceTree::iterator roster_metrics::liveAtRank(int rank) const {
+#ifdef ROSTER_BPLUS
+    return performanceTree.at_rank(rank);
+#else
+    return (deadPerformances == 0) ? performanceTree.at_rank(rank) : performanceTree.at_weight(rank);
+#endif
+}
+
+// move it to the next smaller live performance (end() past the first)
+void roster_metrics::stepDown(PerformanceTree::iterator& it) const {
+    do {
+        --it;
+    } while (deadPerformances > 0 && it != performanceTree.end() && it->secondValue == CLEARED_JERSEY);
+}
+
+// reread the cached leaderboard from the performance index, after
+// changes too wide to patch
+void roster_metrics::refreshTop() {
+    topCount = 0;
+    int count = livePerformances();
+    if (count > 0) {
+        PerformanceTree::iterator it = liveAtRank(count);
+        for (; topCount < TOP_CACHED && it != performanceTree.end(); stepDown(it)) {
+            topPerformances[topCount++] = it->key;
+        }
+    }
+    topVersion++;
+}
+
+// p was just recorded: slide it into the leaderboard if it beats the
+// last cached entry, or if the cache still holds every performance
+void roster_metrics::enterTop(const Performance& p) {
+    if (topCount == TOP_CACHED && p < topPerformances[TOP_CACHED - 1]) {
+        return;
+    }
+    int i = min(topCount, TOP_CACHED - 1); // a full cache drops its last
+    for (; i > 0 && topPerformances[i - 1] < p; --i) {
+        topPerformances[i] = topPerformances[i - 1];
+    }
+    topPerformances[i] = p;
+    topCount = min(topCount + 1, TOP_CACHED);
+    topVersion++;
+}
+
+// p was just cleared: if it was cached, close the gap and pull the
+// next live performance up to the boundary in one O(log n) select
+void roster_metrics::leaveTop(const Performance& p) {
+    if (topCount == 0 || p < topPerformances[topCount - 1]) {
+        return;
+    }
+    int i = 0;
+    while (p < topPerformances[i]) {
+        ++i;
+    }
+    for (; i + 1 < topCount; ++i) {
+        topPerformances[i] = topPerformances[i + 1];
+    }
+    topCount--;
+    int count = livePerformances();
+    if (count > topCount) {
+        topPerformances[topCount] = liveAtRank(count - topCount)->key;
+        topCount++;
+    }
+    topVersion++;
+}
+
+// drop the frozen copy of the roster in slot, if any, before it changes
+void roster_metrics::thaw(int slot) {
+    if ((size_t)slot < frozenRosters.size() && frozenRosters[slot] != nullptr) {
+        if (deferred != nullptr) {
+            deferred->retire(frozenRosters[slot]);
+        } else {
+            delete frozenRosters[slot];
+        }
+        frozenRosters[slot] = nullptr;
     }
 }
 
 // accessor functions
 //ranked receiver(k) | return the jersey with the kth highest performance
     //look at performance tree
-    // Traverse to rightmost node
-    //go back k-1 steps and return the player at that node
-    //recursively call successor until end, then recrusively call predecessor k-1 times
+    //the first TOP_CACHED ranks are read straight from the cached
+    //leaderboard. Past it, the kth highest of n performances is the
+    //(n-k+1)th smallest, which one O(log n) descent finds using
+    //subtree sizes (or live counts, while there are tombstones)
 
 int roster_metrics::ranked_receiver(int rank) {
-    // go to rightmost point
-    AVLTreeNode* current = performanceTree.getRoot();
-    while (current != nullptr && current->right != nullptr) {
-        current = current->right;
+    if (rank >= 1 && rank <= topCount) {
+        return topPerformances[rank - 1].player;
     }
-
-    // go back k-1 positions
-    for (int i = 0; i < rank - 1 && current != nullptr; ++i) {
-        int predecessorKey = performanceTree.Predecessor(current->key);
-        if (predecessorKey == -1) {
-            return -1; // rank not found
-        }
-        current = performanceTree.search(predecessorKey);
+    int count = livePerformances();
+    if (rank < 1 || rank > count) {
+        return -1; // rank not found
     }
 
     // return player
-    if (current != nullptr) {
+    PerformanceTree::iterator current = liveAtRank(count - rank + 1);
+    if (current != performanceTree.end()) {
         return current->secondValue;
     } else {
         return -1; // rank not found
     }
 }
+
+//leaderboard_version() | a counter that moves whenever the top
+//TOP_CACHED performances change, so a reader holding a leaderboard
+//can tell whether it is still current without asking again
+uint64_t roster_metrics::leaderboard_version() const {
+    return topVersion;
+}
+
+//ranked_season_receiver(k) | jersey with the kth highest season
+//total; equal totals rank the higher jersey first, as performances do
+int roster_metrics::ranked_season_receiver(int rank) const {
+    int count = seasonRanking.Size();
+    if (rank < 1 || rank > count) {
+        return -1; // rank not found
+    }
+    return seasonRanking.select(count - rank + 1)->secondValue;
+}
+
+//season_points(r) | jersey r's season total, or -1 if r has no records
+int roster_metrics::season_points(int player) const {
+    SeasonTree::Node* total = seasonTotals.search(player);
+    return (total == nullptr) ? -1 : total->secondValue.points;
+}
+
+//game_points(g, lo, hi) | total points scored in game g by jerseys
+//lo through hi, from the per-game subtree sums in O(log n)
+long long roster_metrics::game_points(int game, int loPlayer, int hiPlayer) const {
+    int slot = findGame(game);
+    if (slot < 0 || loPlayer > hiPlayer) {
+        return 0;
+    }
+    const PlayerTree& players = *gameRosters[slot];
+    if (hiPlayer == INT_MAX) {
+        // hi + 1 would overflow; add jersey INT_MAX on its own
+        PlayerTree::Node* last = players.search(INT_MAX);
+        return players.range_aggregate(loPlayer, hiPlayer) + (last != nullptr ? last->secondValue : 0);
+    }
+    return players.range_aggregate(loPlayer, hiPlayer + 1);
+}
+
+//count_performances(lo, hi) | number of performances worth lo through
+//hi points. Subtree sizes already count every subtree, so two
+//count_less descents answer without a separate count summary
+//(tombstones aside, which the live counts leave out).
+int roster_metrics::count_performances(int loPoints, int hiPoints) const {
+    if (loPoints > hiPoints) {
+        return 0;
+    }
+    int below = liveCountLess(Performance(loPoints, INT_MIN, INT_MIN));
+    if (hiPoints == INT_MAX) {
+        return livePerformances() - below;
+    }
+    return liveCountLess(Performance(hiPoints + 1, INT_MIN, INT_MIN)) - below;
+}
+
+//points(g, r) | points jersey r scored in game g, or -1
+int roster_metrics::points(int game, int player) const {
+    int slot = findGame(game);
+    if (slot < 0) {
+        return -1;
+    }
+    if ((size_t)slot < frozenRosters.size() && frozenRosters[slot] != nullptr) {
+        const int* frozen = frozenRosters[slot]->search(player);
+        return (frozen == nullptr) ? -1 : *frozen;
+    }
+    PlayerTree::Node* playerNode = gameRosters[slot]->search(player);
+    return (playerNode == nullptr) ? -1 : playerNode->secondValue;
+}
+
+//ranked_receiver_in_game(g, k) | jersey with the kth most points in
+//game g, or -1. Ties rank as in ranked_receiver; one select() on the
+//game's own ranking tree, O(log n) in the game's records.
+int roster_metrics::ranked_receiver_in_game(int game, int rank) const {
+    int slot = findGame(game);
+    if (slot < 0) {
+        return -1;
+    }
+    const GameRankTree& ranking = *gameRankings[slot];
+    int count = ranking.Size();
+    if (rank < 1 || rank > count) {
+        return -1; // rank not found
+    }
+    return ranking.select(count - rank + 1)->secondValue;
+}
+
+//top_k_in_game(g, k) | jerseys of game g's k highest performances,
+//best first, in O(log n + k)
+vector<int> roster_metrics::top_k_in_game(int game, int k) const {
+    vector<int> players;
+    int slot = findGame(game);
+    if (slot < 0 || k < 1) {
+        return players;
+    }
+    const GameRankTree& ranking = *gameRankings[slot];
+    players.reserve(min(k, ranking.Size()));
+    for (GameRankTree::reverse_iterator it = ranking.rbegin();
+         it != ranking.rend() && (int)players.size() < k; ++it) {
+        players.push_back(it->secondValue);
+    }
+    return players;
+}
+
+//top_k(k) | jerseys of the k highest performances, best first
+vector<int> roster_metrics::top_k(int k) const {
+    return ranked_range(1, k);
+}
+
+//ranked_range(lo, hi) | jerseys ranked lo through hi, best first
+//one descent finds rank lo, then a single reverse in-order walk
+//streams the rest, instead of hi - lo + 1 separate rank queries.
+//Ranges inside the cached leaderboard are copied from it.
+vector<int> roster_metrics::ranked_range(int lo, int hi) const {
+    vector<int> players;
+    int count = livePerformances();
+    lo = max(lo, 1);
+    hi = min(hi, count);
+    if (lo > hi) {
+        return players;
+    }
+    players.reserve(hi - lo + 1);
+    if (hi <= topCount) {
+        for (int rank = lo; rank <= hi; ++rank) {
+            players.push_back(topPerformances[rank - 1].player);
+        }
+        return players;
+    }
+    PerformanceTree::iterator it = liveAtRank(count - lo + 1);
+    for (int rank = lo; rank <= hi; ++rank, stepDown(it)) {
+        players.push_back(it->secondValue);
+    }
+    return players;
+}
+
+//ranked_receivers(ranks, out) | out[i] = ranked_receiver(ranks[i]) for
+//every i (-1 for ranks out of range). A run of ascending ranks close
+//together is answered by stepping one iterator down the performance
+//tree instead of descending from the root for each rank, so asking for
+//ranks 1..N costs one select plus N steps, and ranks inside the
+//cached leaderboard cost nothing. Nothing is allocated; out must be
+//at least as long as ranks
+void roster_metrics::ranked_receivers(span<const int> ranks, span<int> out) const {
+    int count = livePerformances();
+    // a gap wider than this is cheaper to re-select than to walk
+    int maxStep = 1;
+    for (int n = count; n > 1; n >>= 1) {
+        ++maxStep;
+    }
+    PerformanceTree::iterator it;
+    int at = 0; // rank 'it' is on, 0 when it is not positioned
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        int rank = ranks[i];
+        if (rank < 1 || rank > count) {
+            out[i] = -1; // rank not found
+            continue;
+        }
+        if (rank <= topCount) {
+            out[i] = topPerformances[rank - 1].player;
+            continue;
+        }
+        if (at == 0 || rank < at || rank - at > maxStep) {
+            it = liveAtRank(count - rank + 1);
+        } else {
+            for (; at < rank; ++at) {
+                stepDown(it);
+            }
+        }
+        at = rank;
+        out[i] = it->secondValue;
+    }
+}
+
+//season_totals(season) | fill season with jersey -> total points over
+//every game. The per-game trees are merged by a parallel
+//divide-and-conquer union instead of reinserting node by node.
+void roster_metrics::season_totals(PlayerTree& season, int threads) const {
+    season.Clear();
+    season.union_all(gameRosters, [](int& total, const int& points) { total += points; }, threads);
+}
+
+//enable_snapshots() | start mirroring the performance index into a
+//path-copying tree so snapshot() readers never block on, or observe
+//a half-done, record/clear. Writers pay one extra O(log n) path copy.
+void roster_metrics::enable_snapshots() {
+    if (snapshotsEnabled) {
+        return;
+    }
+    republish();
+    snapshotsEnabled = true;
+}
+
+// replace the published mirror with the live performance index in
+// one O(n) bulk build and a single publish
+void roster_metrics::republish() {
+    vector<pair<Performance, int> > performances, live;
+    performanceTree.collect_sorted(performances);
+    live.reserve(performances.size() - deadPerformances);
+    for (size_t i = 0; i < performances.size(); ++i) {
+        if (performances[i].second != CLEARED_JERSEY) {
+            live.push_back(performances[i]);
+        }
+    }
+    publishedPerformance.build_from_sorted(live);
+}
+
+//snapshot() | the latest published performance index; it stays valid
+//and unchanged for as long as the caller holds it
+PerformanceSnapshot roster_metrics::snapshot() const {
+    return publishedPerformance.snapshot();
+}
+
+//ranked_receiver(snapshot, k) | ranked_receiver(k) as of the snapshot
+int roster_metrics::ranked_receiver(const PerformanceSnapshot& snapshot, int rank) {
+    int count = snapshot.Size();
+    if (rank < 1 || rank > count) {
+        return -1; // rank not found
+    }
+    return snapshot.select(count - rank + 1)->secondValue;
+}
+
+//stats() | aggregate instrumentation over the game trees, the
+//performance index and the game index
+roster_stats roster_metrics::stats() const {
+    roster_stats out;
+    for (size_t i = 0; i < gameRosters.size(); ++i) {
+        gameRosters[i]->collect_stats(out.games);
+        gameRankings[i]->collect_stats(out.gameRanks);
+    }
+    performanceTree.collect_stats(out.performances);
+    seasonTotals.collect_stats(out.season);
+    seasonRanking.collect_stats(out.season);
+    gameTree.collect_stats(out.gameIndex);
+    out.gameCount = gameTree.Size();
+    return out;
+}
+
+roster_stats& roster_stats::operator+=(const roster_stats& other) {
+    games += other.games;
+    gameRanks += other.gameRanks;
+    performances += other.performances;
+    gameIndex += other.gameIndex;
+    season += other.season;
+    gameCount += other.gameCount;
+    return *this;
+}
+
+const PerformanceTree& roster_metrics::performances() const {
+    return performanceTree;
+}
+
+//save_snapshot(path) | write every index as sorted arrays with block
+//checksums. The file is written next to path and renamed into place,
+//so a crash never leaves a half-written snapshot behind.
+bool roster_metrics::save_snapshot(const char* path) const {
+    vector<SnapshotGame> games;
+    vector<SnapshotPlayer> players;
+    vector<SnapshotPerformance> performanceList;
+    games.reserve(gameTree.Size());
+    performanceList.reserve(performanceTree.Size());
+    for (GameTree::iterator g = gameTree.begin(); g != gameTree.end(); ++g) {
+        const PlayerTree& roster = *gameRosters[g->secondValue];
+        SnapshotGame entry = {g->key, (uint32_t)players.size(), (uint32_t)roster.Size()};
+        games.push_back(entry);
+        for (PlayerTree::iterator r = roster.begin(); r != roster.end(); ++r) {
+            SnapshotPlayer player = {r->key, r->secondValue};
+            players.push_back(player);
+        }
+    }
+    for (PerformanceTree::iterator p = performanceTree.begin(); p != performanceTree.end(); ++p) {
+        if (p->secondValue == CLEARED_JERSEY) {
+            continue; // tombstone
+        }
+        SnapshotPerformance entry = {p->key.points, p->key.player, p->key.game};
+        performanceList.push_back(entry);
+    }
+
+    vector<char> payload;
+    payload.insert(payload.end(), (const char*)games.data(), (const char*)(games.data() + games.size()));
+    payload.insert(payload.end(), (const char*)players.data(), (const char*)(players.data() + players.size()));
+    payload.insert(payload.end(), (const char*)performanceList.data(),
+                   (const char*)(performanceList.data() + performanceList.size()));
+
+    vector<uint64_t> blockChecksums;
+    for (size_t start = 0; start < payload.size(); start += SNAPSHOT_BLOCK_SIZE) {
+        size_t bytes = min(SNAPSHOT_BLOCK_SIZE, payload.size() - start);
+        blockChecksums.push_back(snapshot_checksum(payload.data() + start, bytes));
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.gameCount = games.size();
+    header.playerCount = players.size();
+    header.performanceCount = performanceList.size();
+    header.payloadBytes = payload.size();
+    header.tableChecksum = snapshot_checksum(blockChecksums.data(), blockChecksums.size() * sizeof(uint64_t));
+    header.headerChecksum = snapshot_checksum(&header, offsetof(SnapshotHeader, headerChecksum));
+
+    string temp = string(path) + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (out == nullptr) {
+        return false;
+    }
+    // an empty roster has no blocks, and fwrite must not see their
+    // null data pointers
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              (blockChecksums.empty() ||
+               fwrite(blockChecksums.data(), sizeof(uint64_t), blockChecksums.size(), out) == blockChecksums.size()) &&
+              (payload.empty() || fwrite(payload.data(), 1, payload.size(), out) == payload.size());
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(temp.c_str(), path) != 0) {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+//load_snapshot(path) | replace this roster with a snapshot's contents.
+//The arrays are already sorted, so every tree is built bottom-up with
+//build_from_sorted instead of replaying record() calls. On failure
+//the roster is left unchanged.
+bool roster_metrics::load_snapshot(const char* path) {
+    mapped_roster file;
+    if (!file.open(path)) {
+        return false;
+    }
+    const SnapshotGame* games = file.all_games();
+    const SnapshotPlayer* players = file.all_players();
+    const SnapshotPerformance* performanceList = file.all_performances();
+    if (games == nullptr || players == nullptr || performanceList == nullptr) {
+        return false;
+    }
+    // build_from_sorted trusts its input, so check the order first;
+    // open() already checked the games and their player ranges
+    for (size_t g = 0; g < file.game_count(); ++g) {
+        const SnapshotPlayer* first = players + games[g].firstPlayer;
+        for (uint32_t r = 1; r < games[g].playerCount; ++r) {
+            if (first[r - 1].player >= first[r].player) {
+                return false;
+            }
+        }
+    }
+    for (size_t i = 1; i < file.performance_count(); ++i) {
+        const SnapshotPerformance& a = performanceList[i - 1];
+        const SnapshotPerformance& b = performanceList[i];
+        if (!(Performance(a.points, a.player, a.game) < Performance(b.points, b.player, b.game))) {
+            return false;
+        }
+    }
+
+    discardGames();
+
+    vector<pair<int, int> > gameItems, playerItems;
+    gameItems.reserve(file.game_count());
+    for (size_t g = 0; g < file.game_count(); ++g) {
+        playerItems.clear();
+        for (uint32_t r = 0; r < games[g].playerCount; ++r) {
+            const SnapshotPlayer& player = players[games[g].firstPlayer + r];
+            playerItems.push_back(make_pair(player.player, player.points));
+        }
+        PlayerTree* roster = new PlayerTree();
+        roster->build_from_sorted(playerItems);
+        gameItems.push_back(make_pair(games[g].game, (int)gameRosters.size()));
+        gameDirectory.insert(games[g].game, gameRosters.size());
+        gameRosters.push_back(roster);
+        gameRankings.push_back(rankGame(playerItems));
+    }
+    gameTree.build_from_sorted(gameItems);
+
+    vector<pair<Performance, int> > performanceItems;
+    performanceItems.reserve(file.performance_count());
+    for (size_t i = 0; i < file.performance_count(); ++i) {
+        const SnapshotPerformance& p = performanceList[i];
+        performanceItems.push_back(make_pair(Performance(p.points, p.player, p.game), p.player));
+    }
+    performanceTree.build_from_sorted(performanceItems);
+    rebuildSeason();
+    refreshTop();
+
+    if (snapshotsEnabled) {
+        republish();
+    }
+    return true;
+}
+
+// one parsed event of a record file and where it was: chunk << 32 | line
+struct LoadedEvent {
+    Event event;
+    uint64_t position;
+};
+
+// a game built by a load_records partition
+struct LoadedGame {
+    uint64_t firstRecord;   // position of its first record; orders slots
+    int game;
+    PlayerTree* players;
+    GameRankTree* ranking;
+};
+
+// everything one partition of games adds to the roster
+struct LoadedPartition {
+    vector<LoadedGame> games;
+    vector<pair<Performance, int> > performances;   // sorted
+    vector<pair<int, SeasonTotal> > totals;         // sorted by jersey
+};
+
+// partition a game's events go to
+static size_t partitionOf(int game, size_t partitions) {
+    uint32_t h = (uint32_t)game * 2654435761u;
+    return (h ^ (h >> 16)) % partitions;
+}
+
+// merge sorted runs pairwise on pool, each round in parallel, folding
+// items with equal keys together with combine
+template <class Item, class Less, class Combine>
+static vector<Item> mergeRuns(work_pool& pool, vector<vector<Item> >& runs, Less less, Combine combine) {
+    if (runs.empty()) {
+        return vector<Item>();
+    }
+    while (runs.size() > 1) {
+        vector<vector<Item> > merged((runs.size() + 1) / 2);
+        for (size_t i = 0; i < merged.size(); ++i) {
+            pool.submit([&runs, &merged, i, less, combine]() {
+                vector<Item>& a = runs[2 * i];
+                vector<Item>& out = merged[i];
+                if (2 * i + 1 == runs.size()) {
+                    out = move(a);
+                    return;
+                }
+                vector<Item>& b = runs[2 * i + 1];
+                out.reserve(a.size() + b.size());
+                size_t x = 0, y = 0;
+                while (x < a.size() && y < b.size()) {
+                    if (less(a[x], b[y])) {
+                        out.push_back(a[x++]);
+                    } else if (less(b[y], a[x])) {
+                        out.push_back(b[y++]);
+                    } else {
+                        out.push_back(a[x++]);
+                        combine(out.back(), b[y++]);
+                    }
+                }
+                out.insert(out.end(), a.begin() + x, a.end());
+                out.insert(out.end(), b.begin() + y, b.end());
+                vector<Item>().swap(a);
+                vector<Item>().swap(b);
+            });
+        }
+        pool.wait();
+        runs.swap(merged);
+    }
+    return move(runs[0]);
+}
+
+// build partition's games from its events, in file order within each
+// (game, jersey). Only the last event for a jersey matters: a record
+// replaces earlier points and a clear removes them. A game exists
+// once it has had any record, as with record().
+static void buildPartition(vector<LoadedEvent>& events, LoadedPartition& out) {
+    sort(events.begin(), events.end(), [](const LoadedEvent& a, const LoadedEvent& b) {
+        if (a.event.game != b.event.game) return a.event.game < b.event.game;
+        if (a.event.player != b.event.player) return a.event.player < b.event.player;
+        return a.position < b.position;
+    });
+
+    vector<pair<int, int> > players;
+    vector<pair<int, int> > played;   // jersey -> points, every game
+    for (size_t start = 0; start < events.size(); ) {
+        int game = events[start].event.game;
+        uint64_t firstRecord = UINT64_MAX;
+        players.clear();
+        size_t end = start;
+        for (; end < events.size() && events[end].event.game == game; ++end) {
+            const LoadedEvent& e = events[end];
+            if (e.event.type == EVENT_RECORD) {
+                firstRecord = min(firstRecord, e.position);
+            }
+            bool lastForPlayer = end + 1 == events.size() || events[end + 1].event.game != game ||
+                                 events[end + 1].event.player != e.event.player;
+            if (lastForPlayer && e.event.type == EVENT_RECORD) {
+                players.push_back(make_pair(e.event.player, e.event.points));
+                played.push_back(make_pair(e.event.player, e.event.points));
+                out.performances.push_back(make_pair(Performance(e.event.points, e.event.player, game),
+                                                     e.event.player));
+            }
+        }
+        start = end;
+        if (firstRecord == UINT64_MAX) {
+            continue; // only clears: the game never existed
+        }
+        LoadedGame built = {firstRecord, game, new PlayerTree(), rankGame(players)};
+        built.players->build_from_sorted(players);
+        out.games.push_back(built);
+    }
+    vector<LoadedEvent>().swap(events);
+
+    sort(out.performances.begin(), out.performances.end(),
+         [](const pair<Performance, int>& a, const pair<Performance, int>& b) { return a.first < b.first; });
+    sort(played.begin(), played.end());
+    for (size_t i = 0; i < played.size(); ++i) {
+        if (out.totals.empty() || out.totals.back().first != played[i].first) {
+            SeasonTotal start = {0, 0};
+            out.totals.push_back(make_pair(played[i].first, start));
+        }
+        out.totals.back().second.points += played[i].second;
+        out.totals.back().second.games++;
+    }
+}
+
+//load_records(path, threads) | replace this roster with the events of
+//a text record file (see ingest_stream), ending in the state applying
+//them in order would give. Games never interact, so the file is
+//parsed in chunks and split by game across a work-stealing pool of
+//threads (0: one per core); each partition's player trees are built
+//independently and the game, performance and season indexes are
+//assembled from the sorted partial results. Returns false if path
+//cannot be read.
+bool roster_metrics::load_records(const char* path, int threads) {
+    FILE* in = fopen(path, "rb");
+    if (in == nullptr) {
+        return false;
+    }
+    vector<char> text;
+    char block[1 << 16];
+    size_t got;
+    while ((got = fread(block, 1, sizeof(block), in)) > 0) {
+        text.insert(text.end(), block, block + got);
+    }
+    bool failed = ferror(in) != 0;
+    fclose(in);
+    if (failed) {
+        return false;
+    }
+    if (text.empty() || text.back() != '\n') {
+        text.push_back('\n'); // every line, and so every chunk, ends in one
+    }
+
+    // a few chunks and partitions per thread leave room for stealing
+    // when they turn out uneven
+    work_pool pool(threads);
+    size_t chunks = pool.size() * 4;
+    size_t partitions = pool.size() * 4;
+    vector<size_t> cuts(chunks + 1, text.size());
+    cuts[0] = 0;
+    for (size_t c = 1; c < chunks; ++c) {
+        size_t at = max(cuts[c - 1], text.size() / chunks * c);
+        while (at > 0 && at < text.size() && text[at - 1] != '\n') {
+            ++at;
+        }
+        cuts[c] = at;
+    }
+
+    // parse: parts[c][p] holds chunk c's events for partition p
+    vector<vector<vector<LoadedEvent> > > parts(chunks, vector<vector<LoadedEvent> >(partitions));
+    for (size_t c = 0; c < chunks; ++c) {
+        pool.submit([&text, &cuts, &parts, c, partitions]() {
+            char* line = text.data() + cuts[c];
+            char* end = text.data() + cuts[c + 1];
+            for (uint64_t n = 0; line < end; ++n) {
+                char* newline = (char*)memchr(line, '\n', end - line);
+                *newline = '\0';
+                LoadedEvent e;
+                if (parse_event(line, e.event)) {
+                    e.position = (uint64_t)c << 32 | n;
+                    parts[c][partitionOf(e.event.game, partitions)].push_back(e);
+                }
+                line = newline + 1;
+            }
+        });
+    }
+    pool.wait();
+    vector<char>().swap(text);
+
+    // build: each partition's games on their own
+    vector<LoadedPartition> built(partitions);
+    for (size_t p = 0; p < partitions; ++p) {
+        pool.submit([&parts, &built, p, chunks]() {
+            vector<LoadedEvent> events;
+            for (size_t c = 0; c < chunks; ++c) {
+                events.insert(events.end(), parts[c][p].begin(), parts[c][p].end());
+                vector<LoadedEvent>().swap(parts[c][p]);
+            }
+            buildPartition(events, built[p]);
+        });
+    }
+    pool.wait();
+
+    // assemble: slots in order of each game's first record, as serial
+    // record() calls would hand them out
+    discardGames();
+    vector<LoadedGame> games;
+    vector<vector<pair<Performance, int> > > performanceRuns(partitions);
+    vector<vector<pair<int, SeasonTotal> > > totalRuns(partitions);
+    for (size_t p = 0; p < partitions; ++p) {
+        games.insert(games.end(), built[p].games.begin(), built[p].games.end());
+        performanceRuns[p] = move(built[p].performances);
+        totalRuns[p] = move(built[p].totals);
+    }
+    sort(games.begin(), games.end(),
+         [](const LoadedGame& a, const LoadedGame& b) { return a.firstRecord < b.firstRecord; });
+    vector<pair<int, int> > gameItems;
+    gameItems.reserve(games.size());
+    for (size_t i = 0; i < games.size(); ++i) {
+        gameItems.push_back(make_pair(games[i].game, (int)i));
+        gameDirectory.insert(games[i].game, i);
+        gameRosters.push_back(games[i].players);
+        gameRankings.push_back(games[i].ranking);
+    }
+    sort(gameItems.begin(), gameItems.end());
+
+    vector<pair<Performance, int> > performances = mergeRuns(pool, performanceRuns,
+        [](const pair<Performance, int>& a, const pair<Performance, int>& b) { return a.first < b.first; },
+        [](pair<Performance, int>&, const pair<Performance, int>&) {});
+    vector<pair<int, SeasonTotal> > totals = mergeRuns(pool, totalRuns,
+        [](const pair<int, SeasonTotal>& a, const pair<int, SeasonTotal>& b) { return a.first < b.first; },
+        [](pair<int, SeasonTotal>& into, const pair<int, SeasonTotal>& from) {
+            into.second.points += from.second.points;
+            into.second.games += from.second.games;
+        });
+    vector<pair<pair<int, int>, int> > ranking;
+    ranking.reserve(totals.size());
+    for (size_t i = 0; i < totals.size(); ++i) {
+        ranking.push_back(make_pair(make_pair(totals[i].second.points, totals[i].first), totals[i].first));
+    }
+    sort(ranking.begin(), ranking.end());
+
+    // the four indexes are separate trees and build side by side
+    pool.submit([this, &gameItems]() { gameTree.build_from_sorted(gameItems); });
+    pool.submit([this, &performances]() { performanceTree.build_from_sorted(performances); });
+    pool.submit([this, &totals]() { seasonTotals.build_from_sorted(totals); });
+    pool.submit([this, &ranking]() { seasonRanking.build_from_sorted(ranking); });
+    pool.wait();
+    refreshTop();
+
+    if (snapshotsEnabled) {
+        republish();
+    }
+    return true;
+}
@@ -1,21 +1,217 @@
 #ifndef ROSTER_METRICS_H
 #define ROSTER_METRICS_H
+#include <climits>
+#include <span>
+#include <vector>
 #include "AVL_Tree.h"
+#include "BPlusTree.h"
+#include "PersistentAVL.h"
+#include "game_directory.h"
+#include "reclaimer.h"
+
+// Build with -DROSTER_STATS to have every roster tree count
+// comparisons and rotations for stats(); off by default.
+#ifdef ROSTER_STATS
+typedef CountingStats RosterStatsPolicy;
+#else
+typedef NoStats RosterStatsPolicy;
+#endif
+
+// jersey -> points, one per game; each subtree keeps its point sum
+// for game_points()
+typedef AVL_Tree<int, int, less<int>, RosterStatsPolicy, SumAugment> PlayerTree;
+
+// read-only copy of a finished game's PlayerTree
+typedef FrozenTree<int, int> FrozenPlayerTree;
+
+// (points, jersey) -> jersey within one game, so the game's records
+// rank without scanning its PlayerTree
+typedef AVL_Tree<pair<int, int>, int, less<pair<int, int> >, RosterStatsPolicy> GameRankTree;
+
+// game -> slot in gameRosters
+typedef AVL_Tree<int, int, less<int>, RosterStatsPolicy> GameTree;
+
+// One game's points for one jersey. Ordered by points, then jersey,
+// then game, so every record has a distinct key even when point
+// totals tie and clear() can delete exactly one entry.
+struct Performance {
+    int points;
+    int player;
+    int game;
+
+    Performance() : points(0), player(0), game(0) {}
+    Performance(int points, int player, int game)
+        : points(points), player(player), game(game) {}
+
+    bool operator<(const Performance& other) const {
+        if (points != other.points) return points < other.points;
+        if (player != other.player) return player < other.player;
+        return game < other.game;
+    }
+};
+
+inline ostream& operator<<(ostream& out, const Performance& p) {
+    return out << p.points << "(jersey " << p.player << ", game " << p.game << ")";
+}
+
+// one record(g, r, p) call, for bulk loading
+struct Record {
+    int game;
+    int player;
+    int points;
+};
+
+// jersey a lazily cleared performance is left holding (see
+// set_lazy_clear); no real jersey may use it
+const int CLEARED_JERSEY = INT_MIN;
+
+// counts the performances that are still live, so rank queries can
+// step over tombstones
+struct LiveAugment {
+    typedef uint32_t Summary;
+    static Summary identity() { return 0; }
+    static Summary lift(const int& player) { return player != CLEARED_JERSEY; }
+    static Summary combine(const Summary& a, const Summary& b) { return a + b; }
+};
+
+// performance -> jersey. Build with -DROSTER_BPLUS to index
+// performances with a B+-tree (BPlusTree.h) instead of an AVL tree.
+#ifdef ROSTER_BPLUS
+typedef BPlusTree<Performance, int, less<Performance>, RosterStatsPolicy> PerformanceTree;
+#else
+typedef AVL_Tree<Performance, int, less<Performance>, RosterStatsPolicy, LiveAugment> PerformanceTree;
+#endif
+
+// one jersey's running season total
+struct SeasonTotal {
+    int points;
+    int games;   // records adding to points; the jersey leaves at 0
+};
+
+// jersey -> season total
+typedef AVL_Tree<int, SeasonTotal, less<int>, RosterStatsPolicy> SeasonTree;
+
+// (season total, jersey) -> jersey, so totals rank like performances
+typedef AVL_Tree<pair<int, int>, int, less<pair<int, int> >, RosterStatsPolicy> SeasonRankTree;
+
+// stats() over every tree in a roster. Node counts and heights are
+// always filled in; the counters stay zero unless built with
+// ROSTER_STATS.
+struct roster_stats {
+    TreeStats games;          // all per-game player trees together
+    TreeStats gameRanks;      // all per-game rankings together
+    TreeStats performances;   // the performance index
+    TreeStats gameIndex;      // game -> roster lookup tree
+    TreeStats season;         // season totals and their ranking
+    size_t gameCount = 0;
+
+    roster_stats& operator+=(const roster_stats& other);
+};
+
+// lock-free, read-only view of the performance index at one moment
+typedef PersistentAVL<Performance, int>::Snapshot PerformanceSnapshot;
+
 class roster_metrics {
     private:
-        AVL_Tree playerTree;
-        AVL_Tree performanceTree;
-        AVL_Tree gameTree;
+        SeasonTree seasonTotals;
+        SeasonRankTree seasonRanking;
+        PerformanceTree performanceTree;
+        GameTree gameTree;
+        // game -> slot by hash for the hot path; gameTree keeps the order
+        game_directory gameDirectory;
+        int lastGame;     // last game record/clear touched, and its slot
+        int lastSlot;     // (-1 when nothing is cached)
+        // per-game player trees live here rather than in every node
+        vector<PlayerTree*> gameRosters;
+        // each game's records by points, indexed like gameRosters
+        vector<GameRankTree*> gameRankings;
+        // frozen copy of each finished game's roster, or nullptr;
+        // indexed like gameRosters but only grown by finish_game
+        vector<FrozenPlayerTree*> frozenRosters;
+        // path-copying mirror of performanceTree for concurrent readers
+        PersistentAVL<Performance, int> publishedPerformance;
+        bool snapshotsEnabled;
+        // frees dropped games and the roster itself off-thread, if set
+        reclaimer* deferred;
+        // lazy clear: tombstones in performanceTree, the share of it
+        // they may reach before clears start purging them, and the keys
+        // tombstoned so far (some may since have been revived)
+        static constexpr int PURGE_STEP = 8;
+        bool lazyClear;
+        double compactRatio;
+        int deadPerformances;
+        vector<Performance> deadKeys;
+        // the best TOP_CACHED live performances, best first, patched by
+        // record/clear; topVersion moves whenever they change
+        static constexpr int TOP_CACHED = 32;
+        Performance topPerformances[TOP_CACHED];
+        int topCount;
+        uint64_t topVersion;
+
+        void thaw(int slot);
+        int findGame(int game);
+        int findGame(int game) const;
+        void adjustSeason(int player, int points, int games);
+        void rebuildSeason();
+        void discardGames();
+        void republish();
+        void retirePerformance(const Performance& p);
+        void compactPerformances();
+        void purgeDead(int steps);
+        int livePerformances() const;
+        int liveCountLess(const Performance& p) const;
+        PerformanceTree::iterator liveAtRank(int rank) const;
+        void stepDown(PerformanceTree::iterator& it) const;
+        void refreshTop();
+        void enterTop(const Performance& p);
+        void leaveTop(const Performance& p);
     public:
         // constructor
         roster_metrics();
+        ~roster_metrics();
+        roster_metrics(const roster_metrics&) = delete;
+        roster_metrics& operator=(const roster_metrics&) = delete;
 
         // mutator functions
         void record(int game, int player, int points);
         void clear(int game, int player);
+        void record_batch(span<const Record> records);
+        bool finish_game(int game);
+        bool drop_game(int game);
+        void set_reclaimer(reclaimer* deferred);
+        void set_lazy_clear(bool on, double compactRatio = 0.25);
 
         // accessor functions
         int ranked_receiver(int rank);
+        int ranked_season_receiver(int rank) const;
+        int season_points(int player) const;
+        long long game_points(int game, int loPlayer, int hiPlayer) const;
+        int count_performances(int loPoints, int hiPoints) const;
+        int points(int game, int player) const;
+        int ranked_receiver_in_game(int game, int rank) const;
+        vector<int> top_k_in_game(int game, int k) const;
+        vector<int> top_k(int k) const;
+        vector<int> ranked_range(int lo, int hi) const;
+        uint64_t leaderboard_version() const;
+        void ranked_receivers(span<const int> ranks, span<int> out) const;
+        void season_totals(PlayerTree& season, int threads = 1) const;
+        roster_stats stats() const;
+
+        // snapshot reads, safe on any thread while record/clear run
+        void enable_snapshots();
+        PerformanceSnapshot snapshot() const;
+        static int ranked_receiver(const PerformanceSnapshot& snapshot, int rank);
+
+        // binary snapshot files (format in roster_snapshot.h)
+        bool save_snapshot(const char* path) const;
+        bool load_snapshot(const char* path);
+
+        // text record files (format in event_log.h), built in parallel
+        bool load_records(const char* path, int threads = 0);
+
+        // the performance index itself, for merging several rosters;
+        // while lazy clear is on it can hold CLEARED_JERSEY tombstones
+        const PerformanceTree& performances() const;
 };
 
 #endif
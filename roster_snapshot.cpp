@@ -0,0 +1,227 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "roster_snapshot.h"
+using namespace std;
+
+// 64-bit multiply-rotate checksum over 8-byte words, with a final mix;
+// fast enough to verify a block on first touch
+uint64_t snapshot_checksum(const void* data, size_t bytes) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ bytes;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        h ^= word * 0xC2B2AE3D27D4EB4Full;
+        h = ((h << 31) | (h >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+    for (; i < bytes; ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+mapped_roster::mapped_roster() {
+    base = nullptr;
+    length = 0;
+    header = nullptr;
+    blockCount = 0;
+    corrupt = false;
+}
+
+mapped_roster::~mapped_roster() {
+    close();
+}
+
+//open(path) | map a snapshot read-only and check its header, its
+//block checksum table and the shape of its game array. Returns false
+//for a missing, truncated, corrupt or inconsistent file.
+bool mapped_roster::open(const char* path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+    length = info.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    base = (const char*)mapped;
+    header = (const SnapshotHeader*)base;
+
+    // the header and checksum table are small and always verified
+    blockCount = (header->payloadBytes + SNAPSHOT_BLOCK_SIZE - 1) / SNAPSHOT_BLOCK_SIZE;
+    size_t tableBytes = blockCount * sizeof(uint64_t);
+    size_t dataBytes = header->gameCount * sizeof(SnapshotGame) +
+                       header->playerCount * sizeof(SnapshotPlayer) +
+                       header->performanceCount * sizeof(SnapshotPerformance);
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header->byteOrder != SNAPSHOT_BYTE_ORDER ||
+        header->version != SNAPSHOT_VERSION ||
+        header->headerChecksum != snapshot_checksum(header, offsetof(SnapshotHeader, headerChecksum)) ||
+        dataBytes != header->payloadBytes ||
+        length != sizeof(SnapshotHeader) + tableBytes + header->payloadBytes) {
+        close();
+        return false;
+    }
+    blockChecksums = (const uint64_t*)(base + sizeof(SnapshotHeader));
+    if (header->tableChecksum != snapshot_checksum(blockChecksums, tableBytes)) {
+        close();
+        return false;
+    }
+
+    payload = base + sizeof(SnapshotHeader) + tableBytes;
+    games = (const SnapshotGame*)payload;
+    players = (const SnapshotPlayer*)(games + header->gameCount);
+    performances = (const SnapshotPerformance*)(players + header->playerCount);
+
+    // checksums only say the bytes are what was written; queries also
+    // rely on each game's players being in range and on games being
+    // sorted for the binary search. This reads the (small) game array
+    // without checksumming it, so blocks still verify on first touch.
+    for (size_t g = 0; g < header->gameCount; ++g) {
+        if ((uint64_t)games[g].firstPlayer + games[g].playerCount > header->playerCount ||
+            (g > 0 && games[g - 1].game >= games[g].game)) {
+            close();
+            return false;
+        }
+    }
+    verified.reset(new atomic<uint8_t>[blockCount]);
+    for (size_t b = 0; b < blockCount; ++b) {
+        verified[b].store(0, memory_order_relaxed);
+    }
+    corrupt = false;
+    return true;
+}
+
+void mapped_roster::close() {
+    if (base != nullptr) {
+        munmap((void*)base, length);
+    }
+    base = nullptr;
+    length = 0;
+    header = nullptr;
+    verified.reset();
+    blockCount = 0;
+}
+
+bool mapped_roster::is_corrupt() const {
+    return corrupt;
+}
+
+// checksum every not-yet-verified block overlapping [start, start + bytes)
+bool mapped_roster::verify(const void* start, size_t bytes) const {
+    if (corrupt) {
+        return false;
+    }
+    size_t offset = (const char*)start - payload;
+    size_t first = offset / SNAPSHOT_BLOCK_SIZE;
+    size_t last = (offset + (bytes ? bytes : 1) - 1) / SNAPSHOT_BLOCK_SIZE;
+    for (size_t b = first; b <= last && b < blockCount; ++b) {
+        if (verified[b].load(memory_order_acquire)) {
+            continue;
+        }
+        size_t blockStart = b * SNAPSHOT_BLOCK_SIZE;
+        size_t blockBytes = min(SNAPSHOT_BLOCK_SIZE, (size_t)header->payloadBytes - blockStart);
+        if (snapshot_checksum(payload + blockStart, blockBytes) != blockChecksums[b]) {
+            corrupt = true;
+            return false;
+        }
+        verified[b].store(1, memory_order_release);
+    }
+    return true;
+}
+
+// binary search of the game array, verifying each probe
+const SnapshotGame* mapped_roster::findGame(int game) const {
+    size_t lo = 0, hi = header->gameCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!verify(&games[mid], sizeof(SnapshotGame))) {
+            return nullptr;
+        }
+        if (games[mid].game < game) {
+            lo = mid + 1;
+        } else if (games[mid].game > game) {
+            hi = mid;
+        } else {
+            return &games[mid];
+        }
+    }
+    return nullptr;
+}
+
+// accessor functions
+
+//ranked receiver(k) | the kth highest performance is one array slot
+int mapped_roster::ranked_receiver(int rank) const {
+    if (header == nullptr || rank < 1 || (uint64_t)rank > header->performanceCount) {
+        return -1; // rank not found
+    }
+    const SnapshotPerformance* p = &performances[header->performanceCount - rank];
+    if (!verify(p, sizeof(SnapshotPerformance))) {
+        return -1;
+    }
+    return p->player;
+}
+
+//points(g, r) | points jersey r scored in game g, or -1
+int mapped_roster::points(int game, int player) const {
+    if (header == nullptr) {
+        return -1;
+    }
+    const SnapshotGame* g = findGame(game);
+    if (g == nullptr) {
+        return -1;
+    }
+    size_t lo = g->firstPlayer, hi = (size_t)g->firstPlayer + g->playerCount;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (!verify(&players[mid], sizeof(SnapshotPlayer))) {
+            return -1;
+        }
+        if (players[mid].player < player) {
+            lo = mid + 1;
+        } else if (players[mid].player > player) {
+            hi = mid;
+        } else {
+            return players[mid].points;
+        }
+    }
+    return -1;
+}
+
+size_t mapped_roster::game_count() const {
+    return header ? header->gameCount : 0;
+}
+
+size_t mapped_roster::performance_count() const {
+    return header ? header->performanceCount : 0;
+}
+
+const SnapshotGame* mapped_roster::all_games() const {
+    return verify(games, header->gameCount * sizeof(SnapshotGame)) ? games : nullptr;
+}
+
+const SnapshotPlayer* mapped_roster::all_players() const {
+    return verify(players, header->playerCount * sizeof(SnapshotPlayer)) ? players : nullptr;
+}
+
+const SnapshotPerformance* mapped_roster::all_performances() const {
+    return verify(performances, header->performanceCount * sizeof(SnapshotPerformance)) ? performances : nullptr;
+}
@@ -0,0 +1,114 @@
+#ifndef ROSTER_SNAPSHOT_H
+#define ROSTER_SNAPSHOT_H
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+using namespace std;
+
+//------------------------------------------------------------------
+// On-disk snapshot of a roster_metrics
+//
+//   SnapshotHeader
+//   uint64_t blockChecksums[blockCount]   one per BLOCK_SIZE of payload
+//   payload:
+//     SnapshotGame        games[gameCount]                by game id
+//     SnapshotPlayer      players[playerCount]            by game, then jersey
+//     SnapshotPerformance performances[performanceCount]  ascending
+//
+// Every index is stored as a sorted array, i.e. an implicit perfectly
+// balanced tree, so the file holds no pointers and can be mapped at
+// any address. A game's players are players[first, first + count).
+// Integers are stored in the writing host's byte order; byteOrder
+// holds SNAPSHOT_BYTE_ORDER as written, so a file from a host of the
+// other endianness reads back swapped and is refused.
+//------------------------------------------------------------------
+
+const char SNAPSHOT_MAGIC[8] = {'R', 'O', 'S', 'T', 'E', 'R', 'S', '1'};
+const uint32_t SNAPSHOT_VERSION = 2;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+const size_t SNAPSHOT_BLOCK_SIZE = 64 * 1024;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t gameCount;
+    uint32_t byteOrder;          // SNAPSHOT_BYTE_ORDER, host order
+    uint32_t reserved;
+    uint64_t playerCount;
+    uint64_t performanceCount;
+    uint64_t payloadBytes;
+    uint64_t tableChecksum;      // checksum of blockChecksums[]
+    uint64_t headerChecksum;     // checksum of every field above
+};
+
+struct SnapshotGame {
+    int32_t game;
+    uint32_t firstPlayer;
+    uint32_t playerCount;
+};
+
+struct SnapshotPlayer {
+    int32_t player;
+    int32_t points;
+};
+
+struct SnapshotPerformance {
+    int32_t points;
+    int32_t player;
+    int32_t game;
+};
+
+uint64_t snapshot_checksum(const void* data, size_t bytes);
+
+// A read-only roster served straight from a memory-mapped snapshot.
+// Opening checks the header, the checksum table and that every game's
+// player range lies inside the file with games in ascending order;
+// each 64 KiB block of the payload is checksummed the first time a
+// query touches it, so only the pages a query needs are ever faulted in. A query
+// that hits a corrupt block returns -1 and marks the roster corrupt.
+// Queries may run on many threads at once; two of them verifying the
+// same block just checksum it twice. open() and close() may not run
+// alongside queries.
+class mapped_roster {
+    private:
+        const char* base;
+        size_t length;
+        const SnapshotHeader* header;
+        const uint64_t* blockChecksums;
+        const char* payload;
+        const SnapshotGame* games;
+        const SnapshotPlayer* players;
+        const SnapshotPerformance* performances;
+        // per block: 0 unchecked, 1 good
+        unique_ptr<atomic<uint8_t>[]> verified;
+        size_t blockCount;
+        mutable atomic<bool> corrupt;
+
+        bool verify(const void* start, size_t bytes) const;
+        const SnapshotGame* findGame(int game) const;
+    public:
+        // constructor
+        mapped_roster();
+        ~mapped_roster();
+        mapped_roster(const mapped_roster&) = delete;
+        mapped_roster& operator=(const mapped_roster&) = delete;
+
+        bool open(const char* path);
+        void close();
+        bool is_corrupt() const;
+
+        // accessor functions, as on roster_metrics
+        int ranked_receiver(int rank) const;
+        int points(int game, int player) const;
+        size_t game_count() const;
+        size_t performance_count() const;
+
+        // whole sections for restoring a roster_metrics; verifies them
+        const SnapshotGame* all_games() const;
+        const SnapshotPlayer* all_players() const;
+        const SnapshotPerformance* all_performances() const;
+};
+
+#endif
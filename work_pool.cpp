@@ -0,0 +1,119 @@
+#include "work_pool.h"
+using namespace std;
+
+// pool and deque the calling thread works for, if it is a worker
+static thread_local const work_pool* currentPool = nullptr;
+static thread_local size_t currentQueue = 0;
+
+work_pool::work_pool(int threads) {
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    queued = 0;
+    pending = 0;
+    sleepers = 0;
+    nextQueue = 0;
+    stopping = false;
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(new Queue());
+    }
+    for (int i = 0; i < threads; ++i) {
+        workers.push_back(thread(&work_pool::run, this, (size_t)i));
+    }
+}
+
+// finishes everything already submitted before the threads exit
+work_pool::~work_pool() {
+    wait();
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    for (size_t i = 0; i < queues.size(); ++i) {
+        delete queues[i];
+    }
+}
+
+//size() | number of worker threads
+size_t work_pool::size() const {
+    return workers.size();
+}
+
+//submit(task) | run task on some worker. Safe from any thread,
+//including from inside another task.
+void work_pool::submit(function<void()> task) {
+    pending++;
+    size_t target = (currentPool == this) ? currentQueue : nextQueue++ % queues.size();
+    {
+        // counted before it can be taken, so take()'s decrement never
+        // runs ahead of this increment
+        unique_lock<mutex> guard(queues[target]->lock);
+        queued++;
+        queues[target]->tasks.push_back(move(task));
+    }
+    // a worker going to sleep counts itself before checking queued,
+    // so either it sees this task or we see it. Passing through the
+    // lock keeps the notify from landing between its check and wait.
+    if (sleepers > 0) {
+        { unique_lock<mutex> guard(lock); }
+        wake.notify_one();
+    }
+}
+
+//wait() | block until every task submitted so far, and every task
+//those submitted, has finished. Not to be called from a task.
+void work_pool::wait() {
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [this]() { return pending == 0; });
+}
+
+// pop the newest task of our own deque, else steal the oldest from
+// the others, starting with our neighbour
+bool work_pool::take(size_t self, function<void()>& task) {
+    for (size_t k = 0; k < queues.size(); ++k) {
+        Queue& q = *queues[(self + k) % queues.size()];
+        unique_lock<mutex> guard(q.lock);
+        if (q.tasks.empty()) {
+            continue;
+        }
+        if (k == 0) {
+            task = move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            task = move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+// worker loop: run tasks while any are queued, sleep otherwise
+void work_pool::run(size_t self) {
+    currentPool = this;
+    currentQueue = self;
+    function<void()> task;
+    while (true) {
+        if (take(self, task)) {
+            task();
+            task = nullptr;
+            if (--pending == 0) {
+                unique_lock<mutex> guard(lock);
+                idle.notify_all();
+            }
+            continue;
+        }
+        sleepers++;
+        unique_lock<mutex> guard(lock);
+        wake.wait(guard, [this]() { return stopping || queued > 0; });
+        sleepers--;
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// Fixed set of threads running submitted tasks, with work stealing.
+// Each worker has its own deque: tasks a worker submits go on the back
+// of its own deque and it runs them newest first, while an idle worker
+// takes the oldest task from the front of someone else's. Uneven tasks
+// (one huge game next to many small ones) therefore spread over the
+// threads without a shared queue every push and pop contend on. Tasks
+// submitted from outside the pool are dealt round-robin. The counts
+// are atomics; the pool lock is only taken to put a worker to sleep,
+// to wake one, and when wait() blocks.
+class work_pool {
+    private:
+        struct alignas(64) Queue {
+            mutex lock;
+            deque<function<void()> > tasks;
+        };
+        vector<Queue*> queues;
+        vector<thread> workers;
+
+        mutex lock;
+        condition_variable wake;      // workers: a task was queued
+        condition_variable idle;      // wait(): pending reached zero
+        atomic<size_t> queued;        // in some deque, not yet taken
+        atomic<size_t> pending;       // queued or running
+        atomic<size_t> sleepers;      // workers asleep or about to be
+        atomic<size_t> nextQueue;     // round-robin for outside submits
+        bool stopping;                // under lock
+
+        void run(size_t self);
+        bool take(size_t self, function<void()>& task);
+    public:
+        // constructor; threads <= 0 means one per hardware thread
+        explicit work_pool(int threads = 0);
+        ~work_pool();
+        work_pool(const work_pool&) = delete;
+        work_pool& operator=(const work_pool&) = delete;
+
+        size_t size() const;
+        void submit(function<void()> task);
+        void wait();
+};
+
+#endif